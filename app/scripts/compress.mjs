@@ -0,0 +1,28 @@
+// Writes a gzip copy next to every compressible asset in dist/ so the
+// firmware can serve it with Content-Encoding: gzip. Originals stay for
+// clients that don't accept gzip.
+import { readdirSync, readFileSync, statSync, writeFileSync } from "fs"
+import { join } from "path"
+import { gzipSync } from "zlib"
+
+const DIST = new URL("../dist/", import.meta.url).pathname
+const COMPRESSIBLE = /\.(html|js|css|json|webmanifest|svg|txt|ico)$/
+// Not worth a SPIFFS object below this
+const MIN_SIZE = 1024
+
+function walk(dir) {
+  for (const name of readdirSync(dir)) {
+    const path = join(dir, name)
+    if (statSync(path).isDirectory()) {
+      walk(path)
+      continue
+    }
+    if (!COMPRESSIBLE.test(name)) continue
+    const data = readFileSync(path)
+    if (data.length < MIN_SIZE) continue
+    const gz = gzipSync(data, { level: 9 })
+    if (gz.length < data.length * 0.9) writeFileSync(path + ".gz", gz)
+  }
+}
+
+walk(DIST)
@@ -1 +1,3 @@
-export const WEBSOCKET_URL = "ws://192.168.4.1/ws";
+// Control endpoints are served on their own port, apart from the UI assets
+// (CONTROL_HTTP_PORT in main/includes/web_server.hpp)
+export const WEBSOCKET_URL = "ws://192.168.4.1:81/ws";
@@ -28,6 +28,97 @@ export type RcCommand = {
   horn?: boolean;
 };
 
+// Binary control frame, must match main/includes/command.hpp
+export const CONTROL_FRAME_VERSION = 2;
+export const CONTROL_FRAME_SIZE = 12;
+export const CONTROL_AXIS_MAX = 32767;
+export const CONTROL_FLAG_HEADLIGHTS = 1 << 0;
+export const CONTROL_FLAG_HORN = 1 << 1;
+
+// `seq` must go up by one per frame, the car drops anything not newer than
+// the last frame it accepted. The timestamp only needs to be monotonic.
+export function encodeControlFrame(cmd: RcCommand, seq: number, nowMs = performance.now()): ArrayBuffer {
+  const buf = new ArrayBuffer(CONTROL_FRAME_SIZE);
+  const view = new DataView(buf);
+  const axis = (v: number) => Math.round(Math.max(-1, Math.min(1, v)) * CONTROL_AXIS_MAX);
+  let flags = 0;
+  if (cmd.headlights) flags |= CONTROL_FLAG_HEADLIGHTS;
+  if (cmd.horn) flags |= CONTROL_FLAG_HORN;
+  view.setUint8(0, CONTROL_FRAME_VERSION);
+  view.setUint8(1, flags);
+  view.setUint16(2, seq & 0xffff, true);
+  view.setInt16(4, axis(cmd.throttle), true);
+  view.setInt16(6, axis(cmd.steering), true);
+  view.setUint32(8, Math.floor(nowMs) >>> 0, true);
+  return buf;
+}
+
+// Telemetry frame broadcast by the car, must match main/includes/telemetry.hpp
+export const TELEMETRY_FRAME_TYPE = 0x54; // 'T'
+export const TELEMETRY_FRAME_SIZE = 34;
+export const TELEMETRY_LAG_UNKNOWN = 0xffff;
+export const TELEMETRY_RSSI_UNKNOWN = -128;
+
+export type Telemetry = {
+  lights: {
+    headlights: boolean;
+    braking: boolean;
+    reversing: boolean;
+    hazard: boolean;
+    left: boolean;
+    right: boolean;
+  };
+  seq: number;
+  throttle: number; // -1..1 applied setpoint
+  steering: number;
+  motor: number; // -1..1 duty on the motor right now
+  servo: number; // -1..1 shaped steering position
+  rssi: number | null; // dBm, this client
+  loopUs: number;
+  heapFree: number;
+  uptimeMs: number;
+  ackSeq: number; // newest frame of ours the car accepted
+  lagMs: number | null; // its delivery delay above the best recent one
+  role: "http" | "spectator" | "driver"; // ours; spectator commands are ignored
+  vbatMv: number | null; // filtered pack voltage, null without the battery monitor
+  currentMa: number;
+  power: "ok" | "low" | "critical" | "cutoff"; // battery limit on the motor
+};
+
+export function decodeTelemetryFrame(buf: ArrayBuffer): Telemetry | null {
+  if (buf.byteLength !== TELEMETRY_FRAME_SIZE) return null;
+  const view = new DataView(buf);
+  if (view.getUint8(0) !== TELEMETRY_FRAME_TYPE) return null;
+  const lights = view.getUint8(1);
+  const axis = (offset: number) => view.getInt16(offset, true) / CONTROL_AXIS_MAX;
+  const rssi = view.getInt8(12);
+  return {
+    lights: {
+      headlights: (lights & 1) !== 0,
+      braking: (lights & 2) !== 0,
+      reversing: (lights & 4) !== 0,
+      hazard: (lights & 8) !== 0,
+      left: (lights & 16) !== 0,
+      right: (lights & 32) !== 0,
+    },
+    seq: view.getUint16(2, true),
+    throttle: axis(4),
+    steering: axis(6),
+    motor: axis(8),
+    servo: axis(10),
+    rssi: rssi === TELEMETRY_RSSI_UNKNOWN ? null : rssi,
+    loopUs: view.getUint16(14, true),
+    heapFree: view.getUint32(16, true),
+    uptimeMs: view.getUint32(20, true),
+    ackSeq: view.getUint16(24, true),
+    lagMs: view.getUint16(26, true) === TELEMETRY_LAG_UNKNOWN ? null : view.getUint16(26, true),
+    role: (["http", "spectator", "driver"] as const)[view.getUint8(28)] ?? "spectator",
+    vbatMv: view.getUint16(29, true) || null,
+    currentMa: view.getInt16(31, true),
+    power: (["ok", "low", "critical", "cutoff"] as const)[view.getUint8(33)] ?? "ok",
+  };
+}
+
 export interface Transport {
   name: string;
   connected: boolean;
@@ -38,6 +129,7 @@ export interface Transport {
 
 export function createWebSocketTransport(url: string, onStatus?: (s: string) => void): Transport {
   let socket: WebSocket | null = null;
+  let seq = 0;
   const t: Transport = {
     name: "WebSocket",
     connected: false,
@@ -45,6 +137,7 @@ export function createWebSocketTransport(url: string, onStatus?: (s: string) =>
       return new Promise<void>((resolve, reject) => {
         try {
           socket = new WebSocket(url);
+          socket.binaryType = "arraybuffer";
           onStatus?.("Connecting...");
           socket.addEventListener("open", () => {
             t.connected = true;
@@ -73,7 +166,7 @@ export function createWebSocketTransport(url: string, onStatus?: (s: string) =>
     },
     send(cmd: RcCommand) {
       if (socket && socket.readyState === WebSocket.OPEN) {
-        socket.send(JSON.stringify({ type: "rc_command", payload: cmd }));
+        socket.send(encodeControlFrame(cmd, seq++));
       }
     },
   };
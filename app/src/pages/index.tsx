@@ -3,12 +3,13 @@ import { Button } from "@/components/ui/button";
 import { Card, CardContent } from "@/components/ui/card";
 import { Bluetooth, Lightbulb, Volume2, Power, Wifi } from "lucide-react";
 import Joystick from "@/components/controls/JoyStick";
-import { createBluetoothTransport, Transport } from "@/lib/transport";
+import { createBluetoothTransport, decodeTelemetryFrame, encodeControlFrame, Telemetry, Transport } from "@/lib/transport";
 import { toast } from "sonner";
 import { WEBSOCKET_URL } from "@/constants";
 
 const Index = () => {
   const lastCmdRef = useRef<{ throttle: number; steering: number }>({ throttle: 0, steering: 0 });
+  const seqRef = useRef(0);
 
   const [ws, setWs] = useState<WebSocket | null>(null);
   const [transport, setTransport] = useState<Transport | null>(null);
@@ -18,6 +19,7 @@ const Index = () => {
   const [horn, setHorn] = useState(false);
   const [throttle, setThrottle] = useState(0);
   const [steering, setSteering] = useState(0);
+  const [telemetry, setTelemetry] = useState<Telemetry | null>(null);
 
   const isConnected = status === "Connected";
 
@@ -29,6 +31,7 @@ const Index = () => {
 
     const connect = () => {
       socket = new WebSocket(WEBSOCKET_URL);
+      socket.binaryType = "arraybuffer";
 
       socket.onopen = () => {
         setConnectionMode("websocket");
@@ -56,8 +59,10 @@ const Index = () => {
       };
 
       socket.onmessage = (event) => {
-        console.log(event.data);
-        // handle messages here
+        if (event.data instanceof ArrayBuffer) {
+          const t = decodeTelemetryFrame(event.data);
+          if (t) setTelemetry(t);
+        }
       };
     };
 
@@ -78,14 +83,18 @@ const Index = () => {
     };
   }, []);
   useEffect(() => {
-    // Send commands at 20Hz
+    // Send one combined setpoint at 20Hz, the firmware only applies the newest
     const interval = setInterval(() => {
-      if (!transport?.connected) return;
       const { throttle, steering } = lastCmdRef.current;
-      transport.send({ throttle, steering, headlights, horn });
+      const cmd = { throttle, steering, headlights, horn };
+      if (connectionMode === "websocket" && ws && ws.readyState === WebSocket.OPEN) {
+        ws.send(encodeControlFrame(cmd, seqRef.current++));
+      } else if (connectionMode === "bluetooth" && transport?.connected) {
+        transport.send(cmd);
+      }
     }, 50);
     return () => clearInterval(interval);
-  }, [transport, headlights, horn]);
+  }, [ws, transport, connectionMode, headlights, horn]);
 
   const connect = async () => {
     try {
@@ -107,14 +116,6 @@ const Index = () => {
       toast("Disconnected", { description: "Device disconnected" });
     } catch {}
   };
-  const sendControlCommand = (cmd: string) => {
-    if (connectionMode === "websocket" && ws && ws.readyState === WebSocket.OPEN) {
-      ws.send(JSON.stringify({ type: "control", command: cmd }));
-    } else if (connectionMode === "bluetooth" && transport?.connected) {
-      // You can expand this for actual command structure
-      transport.send({ throttle: 0, steering: 0, headlights, horn });
-    }
-  };
   const handleJoystickChange = ({ x, y }: { x: number; y: number }) => {
     const s = Math.max(-1, Math.min(1, x));
     const t = Math.max(-1, Math.min(1, -y));
@@ -122,18 +123,6 @@ const Index = () => {
     setThrottle(t);
     lastCmdRef.current.steering = s;
     lastCmdRef.current.throttle = t;
-
-    // Decide command
-    let throttleCmd = "stop";
-    if (t > 0.3) throttleCmd = "fwd";
-    else if (t < -0.3) throttleCmd = "rev";
-
-    let steeringCmd = "center";
-    if (s > 0.3) steeringCmd = "right";
-    else if (s < -0.3) steeringCmd = "left";
-
-    sendControlCommand(throttleCmd);
-    sendControlCommand(steeringCmd);
   };
 
 
@@ -220,6 +209,24 @@ const Index = () => {
                       <span className="font-mono">{steering.toFixed(2)}</span>
                     </div>
                   </div>
+                  {/* Car-side status from the telemetry stream */}
+                  {telemetry && (
+                    <div className="flex flex-wrap items-center justify-center gap-2 text-xs text-muted-foreground font-mono">
+                      {telemetry.role !== "driver" && <span className="text-destructive">spectating</span>}
+                      <span>motor {telemetry.motor.toFixed(2)}</span>
+                      <span>servo {telemetry.servo.toFixed(2)}</span>
+                      <span>{telemetry.rssi === null ? "rssi --" : `${telemetry.rssi} dBm`}</span>
+                      <span>{telemetry.lagMs === null ? "lag --" : `lag ${telemetry.lagMs} ms`}</span>
+                      <span>loop {telemetry.loopUs} µs</span>
+                      <span>heap {Math.round(telemetry.heapFree / 1024)} KB</span>
+                      {telemetry.vbatMv !== null && (
+                        <span className={telemetry.power !== "ok" ? "text-destructive" : undefined}>
+                          {(telemetry.vbatMv / 1000).toFixed(2)} V {telemetry.currentMa} mA
+                          {telemetry.power !== "ok" && ` ${telemetry.power}`}
+                        </span>
+                      )}
+                    </div>
+                  )}
                 </div>
               </CardContent>
             </Card>
@@ -0,0 +1,148 @@
+// Runs a battery sample stream through the firmware's DMA frame parsing,
+// filters and power limiter (battery_poll) and on into the control path,
+// on a virtual clock, with full throttle held so the motor cap shows.
+//
+//   battery_trace [--rate hz] < samples   "<vbat_mv> <current_ma>" per line,
+//                                         one line per channel pair (default
+//                                         BATTERY_SAMPLE_HZ / 2, slower logs
+//                                         are held to that rate)
+//   battery_trace --synth [seconds] [--charge]
+//                                         print a synthetic stream instead:
+//                                         a discharging pack under throttle
+//                                         bursts, with PWM ripple and noise,
+//                                         then with --charge 10 s on a charger
+//
+// Output is CSV t_ms,vbat_mv,current_ma,level,max_speed,duty_pct, one row
+// per filter block (10 ms). Exits 1 if a cutoff lifts below
+// POWER_CHARGED_MV, i.e. on the rebound instead of a charge.
+// Try: battery_trace --synth 30 --charge | battery_trace
+#include "includes/battery.hpp"
+#include "includes/command.hpp"
+#include "includes/control_task.hpp"
+#include "includes/led_status.hpp"
+#include "includes/motor.hpp"
+#include "includes/servo.hpp"
+#include "esp_adc/adc_continuous.h"
+#include "esp_timer.h"
+#include "hal_trace.hpp"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+Motor gMotor(static_cast<gpio_num_t>(19), static_cast<gpio_num_t>(20), static_cast<gpio_num_t>(21), static_cast<gpio_num_t>(22));
+Servo gServo(static_cast<gpio_num_t>(5));
+
+static const int PAIR_HZ = BATTERY_SAMPLE_HZ / 2;
+static const int64_t TICK_US = 1000000 / CONTROL_TASK_RATE_HZ;
+static const int64_t BLOCK_US = (int64_t)POWER_DECIMATION * 1000000 / PAIR_HZ;
+
+// Inverse of the host stubs' nominal calibration
+static uint32_t to_raw(int32_t pin_mv) {
+    int32_t raw = (pin_mv * 4095 + 1650) / 3300;
+    return raw < 0 ? 0 : (raw > 4095 ? 4095 : (uint32_t)raw);
+}
+
+static void put(adc_digi_output_data_t* d, int gpio, int32_t pin_mv) {
+    d->val = 0;
+    d->type2.channel = gpio;
+    d->type2.data = to_raw(pin_mv);
+}
+
+// First-order pack model: open-circuit voltage falls linearly, sags by
+// I * R, and the H-bridge's switching shows up as a square wave at the
+// 20 kHz PWM's alias at this sample rate
+static int synth(double seconds, bool charge) {
+    const double R_OHM = 0.15;
+    const double ALIAS_HZ = 20000 - 2 * PAIR_HZ;
+    uint32_t lcg = 1;
+    long n = (long)(seconds * PAIR_HZ);
+    for (long i = 0; i < n; i++) {
+        double t = (double)i / PAIR_HZ;
+        double ocv = 3.95 - 0.8 * t / seconds;
+        bool burst = fmod(t, 5.0) < 2.0;
+        double amps = burst ? 1.8 : 0.2;
+        bool high = fmod(t * ALIAS_HZ, 1.0) < 0.5;
+        double ripple_a = burst ? (high ? 0.6 : -0.6) : 0;
+        lcg = lcg * 1664525u + 1013904223u;
+        double noise_v = ((double)(lcg >> 8) / (1u << 24) - 0.5) * 0.04;
+        double vbat = ocv - (amps + ripple_a) * R_OHM + noise_v;
+        printf("%ld %ld\n", lround(vbat * 1000), lround((amps + ripple_a) * 1000));
+    }
+    // Motor idle, the charger holds the cell at its CV voltage
+    for (long i = 0; charge && i < 10 * PAIR_HZ; i++) printf("4150 0\n");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int rate = PAIR_HZ;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--synth") == 0) {
+            double seconds = i + 1 < argc && argv[i + 1][0] != '-' ? atof(argv[++i]) : 40;
+            return synth(seconds, i + 1 < argc && strcmp(argv[i + 1], "--charge") == 0);
+        }
+        if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            rate = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--rate hz] < samples | --synth [seconds] [--charge]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (rate <= 0 || rate > PAIR_HZ) {
+        fprintf(stderr, "rate must be 1..%d Hz\n", PAIR_HZ);
+        return 1;
+    }
+
+    hal_clock_virtual();
+    external_strip_init(4, 4);
+    create_lights_task();
+    gMotor.init();
+    gServo.init();
+    if (!battery_open()) return 1;
+
+    ControlCommand full = {};
+    full.kind = CMD_DRIVE;
+    full.throttle = CONTROL_AXIS_MAX;
+    control_publish(full);
+
+    // One filter block of pairs at a time, then the control ticks it spans
+    static adc_digi_output_data_t block[POWER_DECIMATION * 2];
+    size_t pairs = 0;
+    int64_t in_time = 0, pair_time = 0;     // in units of 1 / (rate * PAIR_HZ) s
+    long vbat, current;
+    int64_t t_us = 0, next_tick_us = 0;
+    PowerLevel prev = POWER_OK;
+    bool ok = true;
+    printf("t_ms,vbat_mv,current_ma,level,max_speed,duty_pct\n");
+    while (scanf("%ld %ld", &vbat, &current) == 2) {
+        in_time += PAIR_HZ;
+        // Sample-and-hold a slower log up to the ADC's pair rate
+        for (; pair_time < in_time; pair_time += rate) {
+            put(&block[2 * pairs], BATTERY_VBAT_GPIO, (int32_t)(vbat / BATTERY_DIVIDER_MUL));
+            put(&block[2 * pairs + 1], BATTERY_CURRENT_GPIO, (int32_t)(current * BATTERY_CURRENT_MV_PER_A / 1000));
+            if (++pairs < POWER_DECIMATION) continue;
+            pairs = 0;
+
+            hal_adc_feed((const uint8_t*)block, sizeof(block));
+            while (battery_poll()) {
+            }
+            t_us += BLOCK_US;
+            for (; next_tick_us < t_us; next_tick_us += TICK_US) {
+                hal_clock_advance(TICK_US);
+                control_step();
+            }
+
+            BatteryStatus s;
+            if (!battery_status(&s)) continue;
+            if (prev == POWER_CUTOFF && s.level != POWER_CUTOFF && s.vbat_mv < POWER_CHARGED_MV) {
+                fprintf(stderr, "FAIL: cutoff lifted at %u mV\n", s.vbat_mv);
+                ok = false;
+            }
+            prev = s.level;
+            printf("%lld,%u,%d,%s,%u,%.1f\n", (long long)(t_us / 1000), s.vbat_mv, s.current_ma,
+                   power_level_name(s.level), s.limit.max_speed,
+                   gMotor.appliedDuty() * 100.0 / gMotor.maxDuty());
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,81 @@
+// Compares the legacy JSON text frame path against the binary control frame
+// path in ws_handler: decode cost only, actuation excluded.
+#include "includes/command.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+static const int ITERATIONS = 1000000;
+static const size_t WS_MAX_SIZE = 1024;
+
+static double cpu_seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double wall_seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char* name, int frames, double wall, double cpu, long sink) {
+    printf("%-22s %10.0f frames/s %8.1f ns/frame cpu  (sink=%ld)\n",
+           name, frames / wall, cpu * 1e9 / frames, sink);
+}
+
+#ifdef HOST_HAVE_CJSON
+// Mirrors the text branch of ws_handler: heap buffer + cJSON tree per frame,
+// two frames (throttle + steering) per joystick event.
+static void bench_json() {
+    static const char* frames[2] = {
+        "{\"type\":\"control\",\"command\":\"fwd\"}",
+        "{\"type\":\"control\",\"command\":\"left\"}",
+    };
+    long sink = 0;
+    double w0 = wall_seconds(), c0 = cpu_seconds();
+    for (int i = 0; i < ITERATIONS; i++) {
+        for (const char* text : frames) {
+            size_t len = strlen(text);
+            uint8_t* payload = (uint8_t*)malloc(WS_MAX_SIZE);
+            memcpy(payload, text, len);
+            ControlCommand cmd;
+            if (command_decode_json((const char*)payload, len, &cmd)) sink += cmd.kind;
+            free(payload);
+        }
+    }
+    report("json (2 frames/event)", ITERATIONS, wall_seconds() - w0, cpu_seconds() - c0, sink);
+}
+#endif
+
+static void bench_binary() {
+    uint8_t wire[CONTROL_FRAME_SIZE];
+    ControlCommand in = {};
+    in.throttle = 24000;
+    in.steering = -12000;
+    in.flags = CONTROL_FLAG_HEADLIGHTS;
+
+    command_encode_binary(in, wire, sizeof(wire));
+
+    long sink = 0;
+    double w0 = wall_seconds(), c0 = cpu_seconds();
+    for (int i = 0; i < ITERATIONS; i++) {
+        uint8_t frame[CONTROL_FRAME_SIZE];
+        memcpy(frame, wire, sizeof(frame));
+        ControlCommand cmd;
+        if (command_decode_binary(frame, sizeof(frame), &cmd)) sink += cmd.throttle + cmd.steering;
+    }
+    report("binary (1 frame/event)", ITERATIONS, wall_seconds() - w0, cpu_seconds() - c0, sink);
+}
+
+int main() {
+#ifdef HOST_HAVE_CJSON
+    bench_json();
+#else
+    printf("json path skipped (built without cJSON)\n");
+#endif
+    bench_binary();
+    return 0;
+}
@@ -0,0 +1,194 @@
+// Full receive -> actuate path on the host: a WS frame (or POST /control
+// body) goes through its handler, the control mailbox and one control step down to the
+// (stubbed) LEDC/GPIO calls. Reports ns, heap allocations and HAL calls per
+// command, and exits non-zero if a path that must not allocate did.
+//
+//   bench_control_path [--trace]   --trace dumps the HAL calls of a few commands as CSV
+#include "includes/command.hpp"
+#include "includes/control_task.hpp"
+#include "includes/led_status.hpp"
+#include "includes/metrics.hpp"
+#include "includes/motor.hpp"
+#include "includes/servo.hpp"
+#include "includes/session.hpp"
+#include "includes/tasks.hpp"
+#include "includes/web_server.hpp"
+#include "esp_http_server.h"
+#include "esp_timer.h"
+#include "hal_trace.hpp"
+#include "host_alloc.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+Motor gMotor(static_cast<gpio_num_t>(19), static_cast<gpio_num_t>(20), static_cast<gpio_num_t>(21), static_cast<gpio_num_t>(22));
+Servo gServo(static_cast<gpio_num_t>(5));
+
+static const int ITERATIONS = 200000;
+
+static int64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static const httpd_uri_t* ws;
+static const httpd_uri_t* control_post;
+
+static const int WS_FD = 42;
+static const int HTTP_FD = 43;
+
+// Socket open plus WS upgrade, like httpd does before the first frame
+static void open_session() {
+    static bool opened = false;
+    if (!opened) {
+        host_httpd_config(CONTROL_HTTP_PORT)->open_fn(nullptr, WS_FD);
+        opened = true;
+    }
+    httpd_req_t req = {};
+    req.method = HTTP_GET;
+    req.host_fd = WS_FD;
+    ws->handler(&req);
+}
+
+static void send_frame(httpd_ws_type_t type, const void* data, size_t len) {
+    httpd_req_t req = {};
+    req.method = HTTP_POST;     // anything but the GET handshake
+    req.host_fd = WS_FD;
+    req.host_frame_type = type;
+    req.host_frame = (const uint8_t*)data;
+    req.host_frame_len = len;
+    ws->handler(&req);
+    control_step();
+}
+
+// One keep-alive HTTP connection posting setpoints
+static void send_post(httpd_ws_type_t type, const void* data, size_t len) {
+    httpd_req_t req = {};
+    req.method = HTTP_POST;
+    req.host_fd = HTTP_FD;
+    req.content_len = len;
+    req.host_frame = (const uint8_t*)data;
+    req.host_frame_len = len;
+    control_post->handler(&req);
+    control_step();
+}
+
+// Alternating setpoints so every command actually reaches the actuators
+static size_t binary_frame(int i, uint8_t* buf) {
+    ControlCommand cmd = {};
+    cmd.seq = (uint16_t)i;
+    cmd.flags = CONTROL_FLAG_HEADLIGHTS;
+    cmd.throttle = (i & 1) ? 24000 : -24000;
+    cmd.steering = (i & 2) ? 12000 : -12000;
+    return command_encode_binary(cmd, buf, CONTROL_FRAME_SIZE);
+}
+
+static size_t rc_command_frame(int i, uint8_t* buf) {
+    return (size_t)snprintf((char*)buf, 128,
+                            "{\"type\":\"rc_command\",\"payload\":{\"throttle\":%s,\"steering\":%s,\"headlights\":true}}",
+                            (i & 1) ? "0.7" : "-0.7", (i & 2) ? "0.4" : "-0.4");
+}
+
+static size_t setpoint_body(int i, uint8_t* buf) {
+    return (size_t)snprintf((char*)buf, 128, "{\"throttle\":%s,\"steering\":%s,\"headlights\":true,\"horn\":false}",
+                            (i & 1) ? "0.7" : "-0.7", (i & 2) ? "0.4" : "-0.4");
+}
+
+static size_t legacy_frame(int i, uint8_t* buf) {
+    static const char* const cmds[] = { "fwd", "left", "rev", "right" };
+    return (size_t)snprintf((char*)buf, 128, "{\"type\":\"control\",\"command\":\"%s\"}", cmds[i & 3]);
+}
+
+// Returns the heap allocations made across all iterations
+static uint64_t bench(const char* name, httpd_ws_type_t type, size_t (*make)(int, uint8_t*),
+                      void (*send)(httpd_ws_type_t, const void*, size_t) = send_frame) {
+    // Frames are built up front so only the firmware path is measured
+    static uint8_t frames[64][128];
+    static size_t lens[64];
+    for (int i = 0; i < 64; i++) lens[i] = make(i, frames[i]);
+
+    open_session();
+    hal_trace_reset();
+    uint64_t allocs = host_alloc_count();
+    int64_t t0 = now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        uint8_t* frame = frames[i & 63];
+        if (type == HTTPD_WS_TYPE_BINARY) {
+            // Fresh seq and timestamp, or the stale filter drops the frame
+            frame[2] = (uint8_t)i;
+            frame[3] = (uint8_t)(i >> 8);
+            uint32_t ms = (uint32_t)(esp_timer_get_time() / 1000);
+            memcpy(frame + 8, &ms, sizeof(ms));   // little-endian host
+        }
+        send(type, frame, lens[i & 63]);
+        // Simulated 50 Hz client, inside the per-session rate limit
+        hal_clock_advance(20000);
+    }
+    int64_t elapsed = now_ns() - t0;
+    allocs = host_alloc_count() - allocs;
+
+    printf("%-12s %8.1f ns/command %6.2f allocs/command %6.2f hal calls/command\n", name,
+           (double)elapsed / ITERATIONS, (double)allocs / ITERATIONS, (double)hal_trace_count() / ITERATIONS);
+    return allocs;
+}
+
+static bool expect_no_allocs(const char* name, uint64_t allocs) {
+    if (allocs == 0) return true;
+    fprintf(stderr, "FAIL: %s made %llu heap allocations after startup\n", name, (unsigned long long)allocs);
+    return false;
+}
+
+static void print_line(void* ctx, const char* line) {
+    fputs(line, stdout);
+}
+
+int main(int argc, char** argv) {
+    external_strip_init(4, 4);
+    create_lights_task();
+    gMotor.init();
+    gServo.init();
+    start_webserver();
+
+    ws = host_httpd_find_handler("/ws", HTTP_GET);
+    control_post = host_httpd_find_handler("/control", HTTP_POST);
+    if (!ws || !control_post) {
+        fprintf(stderr, "no /ws or POST /control handler registered\n");
+        return 1;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--trace") == 0) {
+        open_session();
+        hal_trace_reset();
+        uint8_t frame[CONTROL_FRAME_SIZE];
+        for (int i = 0; i < 4; i++) {
+            send_frame(HTTPD_WS_TYPE_BINARY, frame, binary_frame(i, frame));
+        }
+        printf("t_ns,op,a,b,c\n");
+        hal_trace_dump(stdout);
+        return 0;
+    }
+
+    bool ok = expect_no_allocs("binary", bench("binary", HTTPD_WS_TYPE_BINARY, binary_frame));
+
+    // The WS session must go idle before the HTTP client can take over driving
+    host_httpd_config(CONTROL_HTTP_PORT)->open_fn(nullptr, HTTP_FD);
+    hal_clock_advance(SESSION_DRIVER_TIMEOUT_MS * 1000);
+    ok &= expect_no_allocs("post control", bench("post control", HTTPD_WS_TYPE_TEXT, setpoint_body, send_post));
+#ifdef HOST_HAVE_CJSON
+    uint64_t json_allocs = bench("rc_command", HTTPD_WS_TYPE_TEXT, rc_command_frame);
+    json_allocs += bench("legacy json", HTTPD_WS_TYPE_TEXT, legacy_frame);
+#ifdef STATIC_ALLOCATION
+    // cJSON runs on its arena in this mode
+    ok &= expect_no_allocs("json", json_allocs);
+#endif
+#else
+    (void)rc_command_frame;
+    (void)legacy_frame;
+    printf("json paths skipped (built without cJSON)\n");
+#endif
+    printf("\n/metrics after the run:\n");
+    metrics_format(print_line, nullptr);
+    task_format(print_line, nullptr);
+    return ok ? 0 : 1;
+}
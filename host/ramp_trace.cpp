@@ -0,0 +1,69 @@
+// Prints the duty trajectory the Motor ramp engine produces for a setpoint
+// sequence, replanning mid-ramp the same way Motor::setTarget does.
+//
+//   ramp_trace [max_duty accel_ms decel_ms brake_ms] < setpoints
+//
+// Each input line is "<time_ms> <signed duty>". Output is CSV
+// time_ms,duty,segment sampled every 5 ms (one control tick at 200 Hz).
+#include "includes/ramp.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+struct Setpoint {
+    uint32_t t_ms;
+    int32_t duty;
+};
+
+int main(int argc, char** argv) {
+    uint32_t max_duty = 2047;  // default 20 kHz profile, 11 bit
+    RampLimits limits = { 300, 150, 20 };
+    if (argc == 5) {
+        max_duty = (uint32_t)atoi(argv[1]);
+        limits.accel_ms = (uint32_t)atoi(argv[2]);
+        limits.decel_ms = (uint32_t)atoi(argv[3]);
+        limits.brake_ms = (uint32_t)atoi(argv[4]);
+    } else if (argc != 1) {
+        fprintf(stderr, "usage: %s [max_duty accel_ms decel_ms brake_ms] < setpoints\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<Setpoint> setpoints;
+    unsigned t;
+    int d;
+    while (scanf("%u %d", &t, &d) == 2) {
+        setpoints.push_back({ t, d });
+    }
+    if (setpoints.empty()) return 0;
+
+    RampPlan plan = {};
+    uint32_t plan_start = 0;
+    size_t next = 0;
+    uint32_t end = setpoints.back().t_ms;
+
+    printf("time_ms,duty,segment\n");
+    for (uint32_t now = 0;; now += 5) {
+        while (next < setpoints.size() && setpoints[next].t_ms <= now) {
+            int32_t current = ramp_sample(plan, now - plan_start);
+            plan = ramp_plan(current, setpoints[next].duty, max_duty, limits);
+            plan_start = now;
+            end = std::max(end, now + ramp_duration_ms(plan));
+            next++;
+        }
+
+        uint32_t elapsed = now - plan_start;
+        int segment = -1;
+        uint32_t seg_end = 0;
+        for (uint8_t i = 0; i < plan.count; i++) {
+            seg_end += plan.seg[i].duration_ms;
+            if (elapsed < seg_end) {
+                segment = i;
+                break;
+            }
+        }
+        printf("%u,%d,%d\n", now, ramp_sample(plan, elapsed), segment);
+        if (now >= end && next == setpoints.size()) break;
+    }
+    return 0;
+}
@@ -0,0 +1,144 @@
+// Replays a command recording (GET /recording from the car) through the
+// control path on a virtual clock and prints the HAL calls it makes as CSV,
+// the format of bench_control_path --trace. Setpoints are applied at their
+// recorded offsets with control ticks at CONTROL_TASK_RATE_HZ in between, so
+// a file always gives the same trace.
+//
+//   replay <recording.bin>         trace of a recording
+//   replay --record <out.bin>      drive a scripted session with the recorder
+//                                  on, write its recording, print its trace
+//
+// Round trip: replay --record r.bin > a.csv; replay r.bin > b.csv; cmp a.csv b.csv
+#include "includes/command.hpp"
+#include "includes/control_task.hpp"
+#include "includes/led_status.hpp"
+#include "includes/motor.hpp"
+#include "includes/recorder.hpp"
+#include "includes/recording.hpp"
+#include "includes/servo.hpp"
+#include "esp_timer.h"
+#include "hal_trace.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+Motor gMotor(static_cast<gpio_num_t>(19), static_cast<gpio_num_t>(20), static_cast<gpio_num_t>(21), static_cast<gpio_num_t>(22));
+Servo gServo(static_cast<gpio_num_t>(5));
+
+static const int64_t TICK_US = 1000000 / CONTROL_TASK_RATE_HZ;
+// Ticks after the last setpoint, long enough for any ramp to finish
+static const int64_t TAIL_US = 1000000;
+
+static int64_t start_us;
+static int64_t next_tick_us;
+
+// Control ticks due before `t_us` (from the start), then the clock to it
+static void run_until(int64_t t_us) {
+    while (next_tick_us < t_us) {
+        hal_clock_advance(start_us + next_tick_us - esp_timer_get_time());
+        control_step();
+        next_tick_us += TICK_US;
+    }
+    hal_clock_advance(start_us + t_us - esp_timer_get_time());
+}
+
+// The step at `t_us` takes the place of that tick, as on the car
+static void step_at(int64_t t_us) {
+    run_until(t_us);
+    control_step();
+    if (next_tick_us == t_us) next_tick_us += TICK_US;
+}
+
+// 4 s of a 20 Hz client: forward, through zero into reverse and back,
+// steering sweeps, a horn blip, then a stop. Commands land on tick times.
+static int64_t record_session() {
+    int64_t t_us = 0;
+    for (int i = 0; i < 80; i++) {
+        t_us = (int64_t)i * 50000;
+        int tri = i % 40 < 20 ? i % 40 : 40 - i % 40;
+        ControlCommand cmd = {};
+        cmd.kind = CMD_DRIVE;
+        cmd.seq = (uint16_t)i;
+        cmd.flags = CONTROL_FLAG_HEADLIGHTS | (i == 30 ? CONTROL_FLAG_HORN : 0);
+        cmd.throttle = i == 79 ? 0 : (int16_t)(tri * 2400 - 20000);
+        cmd.steering = (int16_t)((i / 10 % 2 ? 1 : -1) * (i % 10) * 3000);
+        run_until(t_us);
+        control_publish(cmd);
+        step_at(t_us);
+    }
+    return t_us;
+}
+
+static bool write_recording(const char* path) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    uint8_t block[RECORDING_BLOCK_SIZE];
+    for (uint32_t i = 0; i < RECORDER_RAM_BLOCKS; i++) {
+        if (recorder_ram_read(i, block)) fwrite(block, 1, sizeof(block), f);
+    }
+    return fclose(f) == 0;
+}
+
+static bool replay_file(const char* path, int64_t* end_us) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+    fclose(f);
+
+    std::vector<const uint8_t*> blocks;
+    for (size_t off = 0; off + RECORDING_BLOCK_SIZE <= data.size(); off += RECORDING_BLOCK_SIZE) {
+        blocks.push_back(data.data() + off);
+    }
+    RecordingReader reader;
+    recording_reader_init(&reader, blocks.data(), blocks.size());
+    RecordedSetpoint r;
+    bool first = true;
+    uint32_t first_us = 0;
+    while (recording_reader_next(&reader, &r)) {
+        if (first) first_us = r.time_us;
+        first = false;
+        int64_t t_us = (int64_t)(uint32_t)(r.time_us - first_us);
+        run_until(t_us);
+        recorder_apply(r);
+        step_at(t_us);
+        *end_us = t_us;
+    }
+    return !first;
+}
+
+int main(int argc, char** argv) {
+    bool record = argc == 3 && strcmp(argv[1], "--record") == 0;
+    if (argc != 2 && !record) {
+        fprintf(stderr, "usage: %s <recording.bin> | --record <out.bin>\n", argv[0]);
+        return 1;
+    }
+
+    hal_clock_virtual();
+    external_strip_init(4, 4);
+    create_lights_task();
+    gMotor.init();
+    gServo.init();
+    hal_trace_reset();
+    start_us = esp_timer_get_time();
+    next_tick_us = 0;
+
+    int64_t end_us = 0;
+    if (record) {
+        end_us = record_session();
+    } else if (!replay_file(argv[1], &end_us)) {
+        fprintf(stderr, "%s: no records\n", argv[1]);
+        return 1;
+    }
+    run_until(end_us + TAIL_US);
+
+    if (record && !write_recording(argv[2])) {
+        fprintf(stderr, "can't write %s\n", argv[2]);
+        return 1;
+    }
+    printf("t_ns,op,a,b,c\n");
+    hal_trace_dump(stdout);
+    return 0;
+}
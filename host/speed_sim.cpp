@@ -0,0 +1,220 @@
+// Speed loop against a simulated drivetrain. drive() and controls_update()
+// run unchanged; the Motor's LEDC duty feeds a first-order motor model and
+// the model's distance feeds a simulated quadrature count, so duty
+// resolution, encoder quantization and the loop's own slewing are all in
+// the loop. Open loop and closed loop are stepped at a full and a sagging
+// pack, then the loop's cost per iteration is timed. A closed-loop reverse
+// step checks the motor is never driven against the wheel (plugging): the
+// run fails if duty opposes a wheel turning faster than SPEED_REVERSE_MMPS
+// plus the speed estimate's lag.
+//
+//   speed_sim [target_mmps] [--csv]   --csv prints the 3.5 V closed-loop step
+//
+// Plant: v' = (K * vbat * duty - V_FRICTION - v) / TAU while driven, and
+// v' = -v / TAU_COAST coasting. On the real car check the gains against a
+// step logged from /metrics ("speed" line).
+#include "includes/command.hpp"
+#include "includes/controls.hpp"
+#include "includes/control_task.hpp"
+#include "includes/led_status.hpp"
+#include "includes/motor.hpp"
+#include "includes/servo.hpp"
+#include "includes/speed_pid.hpp"
+#include "includes/wheel_encoder.hpp"
+#include "esp_timer.h"
+#include "hal_trace.hpp"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+Motor gMotor(static_cast<gpio_num_t>(19), static_cast<gpio_num_t>(20), static_cast<gpio_num_t>(21), static_cast<gpio_num_t>(22));
+Servo gServo(static_cast<gpio_num_t>(5));
+
+static const double K_MMPS_PER_V = 750;     // ~3 m/s no-load at 4.2 V
+static const double V_FRICTION_MMPS = 150;
+static const double TAU_S = 0.15;
+static const double TAU_COAST_S = 0.6;
+static const int TICK_US = 1000000 / CONTROL_TASK_RATE_HZ;
+static const int SUBSTEPS = 50;             // plant steps per control tick
+static const double PLUG_MARGIN_MMPS = 10;  // speed estimate lag at the reverse threshold
+
+struct Plant {
+    double vbat;
+    double v_mmps;
+    double pos_mm;
+};
+
+static Plant plant;
+static int plugged_us;      // time driven against the wheel's direction
+
+static int32_t plant_counts() {
+    return (int32_t)floor(plant.pos_mm * WHEEL_ENCODER_COUNTS_PER_M / 1000.0);
+}
+
+// One control tick of plant time, following the duty mid-fade
+static void plant_tick() {
+    double dt = (double)TICK_US / SUBSTEPS / 1e6;
+    for (int i = 0; i < SUBSTEPS; i++) {
+        hal_clock_advance(TICK_US / SUBSTEPS);
+        double duty = (double)gMotor.appliedDuty() / gMotor.maxDuty();
+        double v = fabs(plant.v_mmps);
+        double dir = duty < 0 ? -1 : 1;
+        if (duty != 0 && plant.v_mmps * dir < -(SPEED_REVERSE_MMPS + PLUG_MARGIN_MMPS)) plugged_us += TICK_US / SUBSTEPS;
+        if (duty != 0) {
+            double target = K_MMPS_PER_V * plant.vbat * fabs(duty) - V_FRICTION_MMPS;
+            if (target < 0) target = 0;
+            // Sign flips only through zero, the model has no plugging
+            double signed_v = plant.v_mmps * dir;
+            signed_v += (target - signed_v) / TAU_S * dt;
+            plant.v_mmps = signed_v * dir;
+        } else if (v > 0) {
+            plant.v_mmps -= plant.v_mmps / TAU_COAST_S * dt;
+        }
+        plant.pos_mm += plant.v_mmps * dt;
+    }
+}
+
+struct StepResult {
+    int rise_ms;            // to 90% of target, -1 if never
+    double overshoot_pct;
+    double steady_mmps;     // mean over the last 500 ms
+};
+
+static StepResult run_step(bool closed, double vbat, int32_t target_mmps, bool csv) {
+    plant = { vbat, 0, 0 };
+    controls_set_speed_loop(closed ? plant_counts : nullptr, WHEEL_ENCODER_COUNTS_PER_M, nullptr);
+    // Open loop: the throttle that reaches the target on a full pack
+    double duty = (target_mmps + V_FRICTION_MMPS) / (K_MMPS_PER_V * 4.2);
+    int throttle = closed ? (int)((int64_t)target_mmps * CONTROL_AXIS_MAX / SPEED_MAX_MMPS)
+                          : (int)lround(duty * CONTROL_AXIS_MAX);
+    drive(throttle, 0, 0);
+
+    StepResult r = { -1, 0, 0 };
+    double peak = 0, steady = 0;
+    int steady_n = 0;
+    const int ticks = 2000000 / TICK_US;
+    for (int i = 0; i < ticks; i++) {
+        plant_tick();
+        controls_update();
+        double v = plant.v_mmps;
+        if (r.rise_ms < 0 && v >= 0.9 * target_mmps) r.rise_ms = (i + 1) * TICK_US / 1000;
+        if (v > peak) peak = v;
+        if (i >= ticks - 500000 / TICK_US) {
+            steady += v;
+            steady_n++;
+        }
+        if (csv) printf("%d,%ld,%.1f\n", (i + 1) * TICK_US / 1000, (long)target_mmps, v);
+    }
+    r.overshoot_pct = peak > target_mmps ? (peak - target_mmps) * 100.0 / target_mmps : 0;
+    r.steady_mmps = steady / steady_n;
+
+    // Coast back to rest for the next run
+    drive(0, 0, 0);
+    for (int i = 0; i < 3000000 / TICK_US; i++) {
+        plant_tick();
+        controls_update();
+    }
+    return r;
+}
+
+// Closed loop at speed, then full reverse target: ms until the wheel turns
+// backwards, -1 if it never does
+static int run_reverse(double vbat, int32_t target_mmps) {
+    plant = { vbat, 0, 0 };
+    plugged_us = 0;
+    controls_set_speed_loop(plant_counts, WHEEL_ENCODER_COUNTS_PER_M, nullptr);
+    int throttle = (int)((int64_t)target_mmps * CONTROL_AXIS_MAX / SPEED_MAX_MMPS);
+    drive(throttle, 0, 0);
+    for (int i = 0; i < 2000000 / TICK_US; i++) {
+        plant_tick();
+        controls_update();
+    }
+
+    int reversed_ms = -1;
+    drive(-throttle, 0, 0);
+    for (int i = 0; i < 4000000 / TICK_US; i++) {
+        plant_tick();
+        controls_update();
+        if (reversed_ms < 0 && plant.v_mmps < -SPEED_REVERSE_MMPS) reversed_ms = (i + 1) * TICK_US / 1000;
+    }
+
+    drive(0, 0, 0);
+    for (int i = 0; i < 3000000 / TICK_US; i++) {
+        plant_tick();
+        controls_update();
+    }
+    return reversed_ms;
+}
+
+static int64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int main(int argc, char** argv) {
+    int32_t target = 1500;
+    bool csv = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--csv") == 0) csv = true;
+        else target = atoi(argv[i]);
+    }
+    if (target <= 0 || target > SPEED_MAX_MMPS) {
+        fprintf(stderr, "target must be 1..%d mm/s\n", SPEED_MAX_MMPS);
+        return 1;
+    }
+
+    hal_clock_virtual();
+    external_strip_init(4, 4);
+    create_lights_task();
+    gMotor.init();
+    gServo.init();
+    // Linear throttle, so the axis maps straight to duty / speed
+    controls_set_shape(AXIS_THROTTLE, { 0, 0 });
+
+    if (csv) {
+        printf("t_ms,target_mmps,speed_mmps\n");
+        run_step(true, 3.5, target, true);
+        return 0;
+    }
+
+    printf("step to %ld mm/s\n", (long)target);
+    printf("%-7s %5s %8s %12s %12s %8s\n", "loop", "vbat", "rise_ms", "overshoot_%", "steady_mmps", "error_%");
+    static const double VBAT[] = { 4.2, 3.5 };
+    for (int closed = 0; closed < 2; closed++) {
+        for (double vbat : VBAT) {
+            StepResult r = run_step(closed, vbat, target, false);
+            printf("%-7s %5.2f %8d %12.1f %12.1f %8.1f\n", closed ? "closed" : "open", vbat, r.rise_ms,
+                   r.overshoot_pct, r.steady_mmps, (r.steady_mmps - target) * 100.0 / target);
+        }
+    }
+
+    printf("\nreverse %ld -> %ld mm/s\n", (long)target, (long)-target);
+    printf("%5s %12s %10s\n", "vbat", "reversed_ms", "plugged_us");
+    int failed = 0;
+    for (double vbat : VBAT) {
+        int reversed_ms = run_reverse(vbat, target);
+        printf("%5.2f %12d %10d\n", vbat, reversed_ms, plugged_us);
+        if (plugged_us || reversed_ms < 0) failed = 1;
+    }
+    if (failed) {
+        fprintf(stderr, "FAIL: motor driven against the wheel, or never reversed\n");
+        return 1;
+    }
+
+    // Loop cost on this host; the C6 runs the same integer code at 160 MHz
+    const int N = 1000000;
+    SpeedPid pid;
+    speed_pid_init(&pid, SPEED_GAINS_DEFAULT);
+    SpeedEstimate est = {};
+    volatile int32_t sink = 0;
+    int64_t t0 = now_ns();
+    for (int i = 0; i < N; i++) {
+        int32_t measured = speed_estimate(&est, i * 10, (uint32_t)i * TICK_US, WHEEL_ENCODER_COUNTS_PER_M);
+        sink = sink + speed_pid_step(&pid, target, measured, TICK_US);
+    }
+    printf("\nspeed_estimate + speed_pid_step: %.1f ns/iteration (host)\n", (double)(now_ns() - t0) / N);
+    return 0;
+}
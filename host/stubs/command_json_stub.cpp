@@ -0,0 +1,7 @@
+// Stand-in when the host build has no cJSON (IDF_PATH unset): text frames
+// are rejected as parse errors.
+#include "includes/command.hpp"
+
+bool command_decode_json(const char* buf, size_t len, ControlCommand* out) {
+    return false;
+}
@@ -0,0 +1,537 @@
+// Recording stubs for the ESP-IDF APIs used by main/
+#include "hal_trace.hpp"
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "led_strip.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_spiffs.h"
+#include "esp_http_server.h"
+#include "esp_netif.h"
+#include "esp_system.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
+#include <time.h>
+
+static int64_t clock_skip_ns = 0;
+static bool clock_virtual = false;
+
+static int64_t now_ns() {
+    if (clock_virtual) return clock_skip_ns;
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec + clock_skip_ns;
+}
+
+void hal_clock_advance(int64_t us) {
+    clock_skip_ns += us * 1000;
+}
+
+void hal_clock_virtual() {
+    clock_virtual = true;
+    clock_skip_ns = 1000000000;
+}
+
+// --- trace -----------------------------------------------------------------
+
+static HalCall trace[HAL_TRACE_SIZE];
+static size_t trace_count = 0;
+
+static void record(HalOp op, int32_t a = 0, int32_t b = 0, int32_t c = 0) {
+    trace[trace_count & (HAL_TRACE_SIZE - 1)] = { now_ns(), op, a, b, c };
+    trace_count++;
+}
+
+void hal_trace_reset() {
+    trace_count = 0;
+}
+
+size_t hal_trace_count() {
+    return trace_count;
+}
+
+const HalCall& hal_trace_get(size_t i) {
+    return trace[i & (HAL_TRACE_SIZE - 1)];
+}
+
+const char* hal_op_name(HalOp op) {
+    static const char* const names[HAL_OP_COUNT] = {
+        "gpio_level", "ledc_timer", "ledc_channel", "ledc_set_duty", "ledc_update",
+        "ledc_fade", "ledc_fade_stop", "strip_pixel", "strip_refresh", "task_notify", "ws_send",
+    };
+    return op < HAL_OP_COUNT ? names[op] : "?";
+}
+
+void hal_trace_dump(FILE* out) {
+    size_t first = trace_count > HAL_TRACE_SIZE ? trace_count - HAL_TRACE_SIZE : 0;
+    int64_t t0 = first < trace_count ? hal_trace_get(first).t_ns : 0;
+    for (size_t i = first; i < trace_count; i++) {
+        const HalCall& c = hal_trace_get(i);
+        fprintf(out, "%lld,%s,%ld,%ld,%ld\n", (long long)(c.t_ns - t0), hal_op_name(c.op),
+                (long)c.a, (long)c.b, (long)c.c);
+    }
+}
+
+// --- gpio ------------------------------------------------------------------
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num) { return ESP_OK; }
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode) { return ESP_OK; }
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level) {
+    record(HAL_GPIO_LEVEL, gpio_num, (int32_t)level);
+    return ESP_OK;
+}
+
+// --- ledc ------------------------------------------------------------------
+
+struct LedcChannel {
+    uint32_t pending;       // set_duty, not yet latched
+    uint32_t duty;          // output duty, or fade start
+    uint32_t fade_target;
+    int64_t fade_start_ns;
+    int64_t fade_ns;        // 0 = no fade running
+};
+
+static LedcChannel channels[LEDC_CHANNEL_MAX];
+
+uint32_t hal_ledc_duty(int channel) {
+    LedcChannel& ch = channels[channel];
+    if (ch.fade_ns == 0) return ch.duty;
+    int64_t elapsed = now_ns() - ch.fade_start_ns;
+    if (elapsed >= ch.fade_ns) {
+        ch.duty = ch.fade_target;
+        ch.fade_ns = 0;
+        return ch.duty;
+    }
+    return (uint32_t)((int64_t)ch.duty + ((int64_t)ch.fade_target - (int64_t)ch.duty) * elapsed / ch.fade_ns);
+}
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t* cfg) {
+    if (cfg->freq_hz == 0 || ((uint64_t)cfg->freq_hz << cfg->duty_resolution) > 80000000ULL) {
+        return ESP_FAIL;
+    }
+    record(HAL_LEDC_TIMER, cfg->timer_num, (int32_t)cfg->freq_hz, cfg->duty_resolution);
+    return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t* cfg) {
+    channels[cfg->channel] = { cfg->duty, cfg->duty, cfg->duty, 0, 0 };
+    record(HAL_LEDC_CHANNEL, cfg->channel, cfg->gpio_num, cfg->timer_sel);
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty) {
+    channels[channel].pending = duty;
+    record(HAL_LEDC_SET_DUTY, channel, (int32_t)duty);
+    return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t speed_mode, ledc_channel_t channel) {
+    LedcChannel& ch = channels[channel];
+    ch.duty = ch.pending;
+    ch.fade_ns = 0;
+    record(HAL_LEDC_UPDATE, channel, (int32_t)ch.duty);
+    return ESP_OK;
+}
+
+uint32_t ledc_get_duty(ledc_mode_t speed_mode, ledc_channel_t channel) {
+    return hal_ledc_duty(channel);
+}
+
+esp_err_t ledc_fade_func_install(int intr_alloc_flags) { return ESP_OK; }
+
+esp_err_t ledc_set_fade_with_time(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t target_duty, int max_fade_time_ms) {
+    LedcChannel& ch = channels[channel];
+    ch.duty = hal_ledc_duty(channel);
+    ch.fade_target = target_duty;
+    ch.fade_ns = (int64_t)max_fade_time_ms * 1000000;
+    record(HAL_LEDC_FADE, channel, (int32_t)target_duty, max_fade_time_ms);
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_start(ledc_mode_t speed_mode, ledc_channel_t channel, ledc_fade_mode_t fade_mode) {
+    channels[channel].fade_start_ns = now_ns();
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_stop(ledc_mode_t speed_mode, ledc_channel_t channel) {
+    LedcChannel& ch = channels[channel];
+    if (ch.fade_ns == 0) return ESP_OK;
+    ch.duty = hal_ledc_duty(channel);
+    ch.fade_ns = 0;
+    record(HAL_LEDC_FADE_STOP, channel, (int32_t)ch.duty);
+    return ESP_OK;
+}
+
+// --- led_strip -------------------------------------------------------------
+
+struct led_strip_t {
+    uint32_t max_leds;
+};
+
+static led_strip_t strips[4];
+static size_t strip_count = 0;
+
+esp_err_t led_strip_new_rmt_device(const led_strip_config_t* led_config, const led_strip_rmt_config_t* rmt_config, led_strip_handle_t* ret_strip) {
+    if (strip_count >= 4) return ESP_ERR_NO_MEM;
+    strips[strip_count].max_leds = led_config->max_leds;
+    *ret_strip = &strips[strip_count++];
+    return ESP_OK;
+}
+
+esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue) {
+    if (index >= strip->max_leds) return ESP_ERR_INVALID_ARG;
+    record(HAL_STRIP_PIXEL, (int32_t)index, (int32_t)((red << 16) | (green << 8) | blue));
+    return ESP_OK;
+}
+
+esp_err_t led_strip_refresh(led_strip_handle_t strip) {
+    record(HAL_STRIP_REFRESH, (int32_t)strip->max_leds);
+    return ESP_OK;
+}
+
+esp_err_t led_strip_clear(led_strip_handle_t strip) {
+    return led_strip_refresh(strip);
+}
+
+// --- esp_timer ---------------------------------------------------------------
+
+struct esp_timer {
+    esp_timer_create_args_t args;
+};
+
+static esp_timer timers[16];
+static size_t timer_count = 0;
+
+uint32_t esp_get_free_heap_size(void) {
+    return 0;
+}
+
+esp_err_t esp_wifi_ap_get_sta_list(wifi_sta_list_t* sta) {
+    sta->num = 0;
+    return ESP_OK;
+}
+
+esp_netif_t* esp_netif_get_handle_from_ifkey(const char* if_key) {
+    return NULL;
+}
+
+esp_err_t esp_netif_dhcps_get_clients_by_mac(esp_netif_t* esp_netif, int num, esp_netif_pair_mac_ip_t* mac_ip_pair) {
+    return ESP_FAIL;
+}
+
+int64_t esp_timer_get_time(void) {
+    return now_ns() / 1000;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out) {
+    if (timer_count >= 16) return ESP_ERR_NO_MEM;
+    timers[timer_count].args = *args;
+    *out = &timers[timer_count++];
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) { return ESP_OK; }
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) { return ESP_OK; }
+esp_err_t esp_timer_restart(esp_timer_handle_t timer, uint64_t timeout_us) { return ESP_OK; }
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) { return ESP_OK; }
+
+// --- FreeRTOS ----------------------------------------------------------------
+
+struct tskTaskControlBlock {
+    const char* name;
+    UBaseType_t priority;
+    uint32_t stack_depth;
+};
+
+static tskTaskControlBlock tasks[16];
+static size_t task_count = 0;
+static tskTaskControlBlock host_task = { "host", 1, 8192 };
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack_depth, void* param,
+                       UBaseType_t priority, TaskHandle_t* created) {
+    if (task_count >= 16) return pdFALSE;
+    tasks[task_count] = { name, priority, stack_depth };
+    if (created) *created = &tasks[task_count];
+    task_count++;
+    return pdPASS;
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t fn, const char* name, uint32_t stack_depth, void* param,
+                               UBaseType_t priority, StackType_t* stack, StaticTask_t* tcb) {
+    TaskHandle_t task = nullptr;
+    xTaskCreate(fn, name, stack_depth, param, priority, &task);
+    return task;
+}
+
+void vTaskDelete(TaskHandle_t task) {}
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return &host_task; }
+char* pcTaskGetName(TaskHandle_t task) { return (char*)task->name; }
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) { return task->priority; }
+// Tasks never run on the host, their stacks are untouched
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) { return task->stack_depth; }
+void vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority) {}
+void vTaskDelay(TickType_t ticks) {}
+void vTaskDelayUntil(TickType_t* previous_wake, TickType_t increment) { *previous_wake += increment; }
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait) { return 0; }
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    record(HAL_TASK_NOTIFY);
+    return pdPASS;
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)(now_ns() / (1000000000LL / configTICK_RATE_HZ));
+}
+
+// --- SPIFFS ------------------------------------------------------------------
+
+esp_err_t esp_vfs_spiffs_register(const esp_vfs_spiffs_conf_t* conf) { return ESP_OK; }
+esp_err_t esp_vfs_spiffs_unregister(const char* partition_label) { return ESP_OK; }
+
+// --- esp_partition -----------------------------------------------------------
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label) {
+    return NULL;
+}
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size) { return ESP_FAIL; }
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size) { return ESP_FAIL; }
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size) { return ESP_FAIL; }
+
+// --- esp_adc -----------------------------------------------------------------
+
+static int adc_ctx;
+static const uint8_t* adc_feed = nullptr;
+static size_t adc_feed_len = 0;
+
+void hal_adc_feed(const uint8_t* data, size_t len) {
+    adc_feed = data;
+    adc_feed_len = len;
+}
+
+esp_err_t adc_continuous_new_handle(const adc_continuous_handle_cfg_t* hdl_config, adc_continuous_handle_t* ret_handle) {
+    *ret_handle = (adc_continuous_handle_t)&adc_ctx;
+    return ESP_OK;
+}
+esp_err_t adc_continuous_config(adc_continuous_handle_t handle, const adc_continuous_config_t* config) { return ESP_OK; }
+esp_err_t adc_continuous_register_event_callbacks(adc_continuous_handle_t handle, const adc_continuous_evt_cbs_t* cbs, void* user_data) {
+    return ESP_OK;
+}
+esp_err_t adc_continuous_start(adc_continuous_handle_t handle) { return ESP_OK; }
+
+esp_err_t adc_continuous_read(adc_continuous_handle_t handle, uint8_t* buf, uint32_t length_max, uint32_t* out_length, uint32_t timeout_ms) {
+    if (adc_feed_len == 0) return ESP_ERR_TIMEOUT;
+    size_t n = adc_feed_len < length_max ? adc_feed_len : length_max;
+    memcpy(buf, adc_feed, n);
+    adc_feed += n;
+    adc_feed_len -= n;
+    *out_length = (uint32_t)n;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_io_to_channel(int io_num, adc_unit_t* unit_id, adc_channel_t* channel) {
+    if (io_num < 0 || io_num > 6) return ESP_ERR_NOT_FOUND;
+    *unit_id = ADC_UNIT_1;
+    *channel = (adc_channel_t)io_num;
+    return ESP_OK;
+}
+
+static int adc_cali_ctx;
+
+esp_err_t adc_cali_create_scheme_curve_fitting(const adc_cali_curve_fitting_config_t* config, adc_cali_handle_t* ret_handle) {
+    *ret_handle = (adc_cali_handle_t)&adc_cali_ctx;
+    return ESP_OK;
+}
+
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t handle, int raw, int* voltage) {
+    *voltage = raw * 3300 / 4095;
+    return ESP_OK;
+}
+
+// --- esp_http_server ---------------------------------------------------------
+
+static httpd_uri_t handlers[32];
+static size_t handler_count = 0;
+static httpd_config_t server_configs[4];
+static size_t server_count = 0;
+static char response[4096];
+static size_t response_len = 0;
+
+static void append_response(const char* buf, size_t len) {
+    if (len > sizeof(response) - 1 - response_len) len = sizeof(response) - 1 - response_len;
+    memcpy(response + response_len, buf, len);
+    response_len += len;
+    response[response_len] = '\0';
+}
+
+const char* host_httpd_response(void) {
+    return response;
+}
+
+void host_httpd_reset_response(void) {
+    response_len = 0;
+    response[0] = '\0';
+}
+
+bool httpd_uri_match_wildcard(const char* reference_uri, const char* uri_to_match, size_t match_upto) {
+    size_t ref_len = strlen(reference_uri);
+    if (ref_len && reference_uri[ref_len - 1] == '*') {
+        return strncmp(reference_uri, uri_to_match, ref_len - 1) == 0;
+    }
+    return strlen(reference_uri) == match_upto && strncmp(reference_uri, uri_to_match, match_upto) == 0;
+}
+
+httpd_config_t* host_httpd_config(uint16_t port) {
+    for (size_t i = 0; i < server_count; i++) {
+        if (server_configs[i].server_port == port) return &server_configs[i];
+    }
+    return NULL;
+}
+
+esp_err_t httpd_start(httpd_handle_t* handle, const httpd_config_t* config) {
+    if (server_count >= 4) return ESP_ERR_NO_MEM;
+    server_configs[server_count] = *config;
+    *handle = &server_configs[server_count++];
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle) { return ESP_OK; }
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t* uri_handler) {
+    if (handler_count >= 32) return ESP_ERR_NO_MEM;
+    handlers[handler_count++] = *uri_handler;
+    return ESP_OK;
+}
+
+const httpd_uri_t* host_httpd_find_handler(const char* uri, httpd_method_t method) {
+    for (size_t i = 0; i < handler_count; i++) {
+        if (handlers[i].method == method && strcmp(handlers[i].uri, uri) == 0) return &handlers[i];
+    }
+    return NULL;
+}
+
+int httpd_req_to_sockfd(httpd_req_t* r) {
+    return r->host_fd;
+}
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t* r, const char* field) { return 0; }
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t* r, const char* field, char* val, size_t val_size) {
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t* r, char* buf, size_t buf_len) {
+    const char* q = strchr(r->uri, '?');
+    if (!q) return ESP_ERR_NOT_FOUND;
+    if (strlen(q + 1) >= buf_len) return ESP_ERR_HTTPD_RESULT_TRUNC;
+    strcpy(buf, q + 1);
+    return ESP_OK;
+}
+
+esp_err_t httpd_query_key_value(const char* qry, const char* key, char* val, size_t val_size) {
+    size_t key_len = strlen(key);
+    for (const char* p = qry; p && *p; p = strchr(p, '&') ? strchr(p, '&') + 1 : NULL) {
+        if (strncmp(p, key, key_len) != 0 || p[key_len] != '=') continue;
+        const char* v = p + key_len + 1;
+        size_t n = strcspn(v, "&");
+        if (n >= val_size) return ESP_ERR_HTTPD_RESULT_TRUNC;
+        memcpy(val, v, n);
+        val[n] = '\0';
+        return ESP_OK;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+int httpd_req_recv(httpd_req_t* r, char* buf, size_t buf_len) {
+    size_t left = r->host_frame_len - r->host_body_offset;
+    size_t n = buf_len < left ? buf_len : left;
+    memcpy(buf, r->host_frame + r->host_body_offset, n);
+    r->host_body_offset += n;
+    return (int)n;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t* r, const char* buf, ssize_t buf_len) {
+    if (buf) append_response(buf, buf_len == HTTPD_RESP_USE_STRLEN ? strlen(buf) : (size_t)buf_len);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t* r, const char* buf, ssize_t buf_len) {
+    if (buf) append_response(buf, buf_len == HTTPD_RESP_USE_STRLEN ? strlen(buf) : (size_t)buf_len);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_sendstr_chunk(httpd_req_t* r, const char* str) {
+    return httpd_resp_send_chunk(r, str, HTTPD_RESP_USE_STRLEN);
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t* r, const char* type) { return ESP_OK; }
+esp_err_t httpd_resp_set_status(httpd_req_t* r, const char* status) { return ESP_OK; }
+esp_err_t httpd_resp_set_hdr(httpd_req_t* r, const char* field, const char* value) { return ESP_OK; }
+
+esp_err_t httpd_resp_send_404(httpd_req_t* r) {
+    return httpd_resp_send(r, "404", HTTPD_RESP_USE_STRLEN);
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t* r, httpd_err_code_t error, const char* msg) {
+    return httpd_resp_send(r, msg, HTTPD_RESP_USE_STRLEN);
+}
+
+esp_err_t httpd_ws_recv_frame(httpd_req_t* req, httpd_ws_frame_t* pkt, size_t max_len) {
+    pkt->type = req->host_frame_type;
+    pkt->final = true;
+    pkt->len = req->host_frame_len;
+    if (max_len == 0) return ESP_OK;
+    if (req->host_frame_len > max_len) return ESP_ERR_INVALID_SIZE;
+    memcpy(pkt->payload, req->host_frame, req->host_frame_len);
+    return ESP_OK;
+}
+
+static int ws_clients[16];
+static size_t ws_client_count;
+
+void host_httpd_set_clients(const int* fds, size_t count) {
+    ws_client_count = count < 16 ? count : 16;
+    memcpy(ws_clients, fds, ws_client_count * sizeof(int));
+}
+
+esp_err_t httpd_get_client_list(httpd_handle_t handle, size_t* fds, int* client_fds) {
+    if (*fds < ws_client_count) return ESP_ERR_INVALID_ARG;
+    memcpy(client_fds, ws_clients, ws_client_count * sizeof(int));
+    *fds = ws_client_count;
+    return ESP_OK;
+}
+
+httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t hd, int fd) {
+    for (size_t i = 0; i < ws_client_count; i++) {
+        if (ws_clients[i] == fd) return HTTPD_WS_CLIENT_WEBSOCKET;
+    }
+    return HTTPD_WS_CLIENT_INVALID;
+}
+
+esp_err_t httpd_ws_send_data_async(httpd_handle_t handle, int socket, httpd_ws_frame_t* frame,
+                                   transfer_complete_cb callback, void* arg) {
+    record(HAL_WS_SEND, socket, frame->type, (int32_t)frame->len);
+    if (callback) callback(ESP_OK, socket, arg);
+    return ESP_OK;
+}
+
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t* frame) {
+    record(HAL_WS_SEND, fd, frame->type, (int32_t)frame->len);
+    return ESP_OK;
+}
+
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void* arg) {
+    work(arg);
+    return ESP_OK;
+}
+
+esp_err_t httpd_ws_send_frame(httpd_req_t* req, httpd_ws_frame_t* pkt) {
+    record(HAL_WS_SEND, req->host_fd, pkt->type, (int32_t)pkt->len);
+    host_httpd_reset_response();
+    append_response((const char*)pkt->payload, pkt->len);
+    return ESP_OK;
+}
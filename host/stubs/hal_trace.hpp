@@ -0,0 +1,50 @@
+#pragma once
+// Every register-level call the host stubs see, with a timestamp. Fixed
+// ring, no allocation, so it can stay on while counting allocations.
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+enum HalOp : uint8_t {
+    HAL_GPIO_LEVEL,         // a = pin, b = level
+    HAL_LEDC_TIMER,         // a = timer, b = freq_hz, c = resolution bits
+    HAL_LEDC_CHANNEL,       // a = channel, b = gpio, c = timer
+    HAL_LEDC_SET_DUTY,      // a = channel, b = duty
+    HAL_LEDC_UPDATE,        // a = channel, b = duty now active
+    HAL_LEDC_FADE,          // a = channel, b = target duty, c = time ms
+    HAL_LEDC_FADE_STOP,     // a = channel, b = duty reached
+    HAL_STRIP_PIXEL,        // a = index, b = 0xRRGGBB
+    HAL_STRIP_REFRESH,      // a = pixel count
+    HAL_TASK_NOTIFY,
+    HAL_WS_SEND,            // a = fd, b = type, c = length
+    HAL_OP_COUNT,
+};
+
+struct HalCall {
+    int64_t t_ns;
+    HalOp op;
+    int32_t a, b, c;
+};
+
+#define HAL_TRACE_SIZE (1 << 16)
+
+void hal_trace_reset();
+// Total calls recorded since reset (the ring keeps the newest HAL_TRACE_SIZE)
+size_t hal_trace_count();
+const HalCall& hal_trace_get(size_t i);
+const char* hal_op_name(HalOp op);
+void hal_trace_dump(FILE* out);
+
+// Moves the stubs' clock (esp_timer, fades, trace) forward without waiting,
+// for simulating frame spacing
+void hal_clock_advance(int64_t us);
+// Stop following the real clock: time is 1 s and only hal_clock_advance moves
+// it, so runs are repeatable to the nanosecond. Call before any init.
+void hal_clock_virtual();
+
+// Current duty of an LEDC channel, following a running hardware fade
+uint32_t hal_ledc_duty(int channel);
+
+// Queue DMA frame bytes (adc_digi_output_data_t results) for the next
+// adc_continuous_read() calls; `data` must outlive them
+void hal_adc_feed(const uint8_t* data, size_t len);
@@ -0,0 +1,6 @@
+#pragma once
+#include <stdint.h>
+
+// Heap allocations (malloc/calloc/realloc, and new through them) made by
+// this process so far
+uint64_t host_alloc_count();
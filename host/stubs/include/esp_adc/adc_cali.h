@@ -0,0 +1,8 @@
+#pragma once
+// Host stub: calibration is the nominal linear 12 dB scale, 4095 = 3300 mV
+#include "esp_err.h"
+#include "hal/adc_types.h"
+
+typedef struct adc_cali_scheme_t* adc_cali_handle_t;
+
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t handle, int raw, int* voltage);
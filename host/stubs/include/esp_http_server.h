@@ -0,0 +1,195 @@
+#pragma once
+// Host stub: handlers registered by start_webserver() are kept in a table so
+// host code can look them up and call them with a fake request.
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>  // the IDF header pulls this in too
+#include <sys/types.h>
+#include "esp_err.h"
+
+typedef void* httpd_handle_t;
+
+typedef enum {
+    HTTP_DELETE = 0,
+    HTTP_GET = 1,
+    HTTP_HEAD = 2,
+    HTTP_POST = 3,
+    HTTP_PUT = 4,
+} httpd_method_t;
+
+#define HTTPD_RESP_USE_STRLEN -1
+#define ESP_ERR_HTTPD_BASE (0xb000)
+#define ESP_ERR_HTTPD_RESULT_TRUNC (ESP_ERR_HTTPD_BASE + 6)
+#define HTTPD_MAX_URI_LEN 512
+#define HTTPD_SOCK_ERR_FAIL -1
+#define HTTPD_SOCK_ERR_INVALID -2
+#define HTTPD_SOCK_ERR_TIMEOUT -3
+
+typedef enum {
+    HTTPD_WS_TYPE_CONTINUE = 0x0,
+    HTTPD_WS_TYPE_TEXT = 0x1,
+    HTTPD_WS_TYPE_BINARY = 0x2,
+    HTTPD_WS_TYPE_CLOSE = 0x8,
+    HTTPD_WS_TYPE_PING = 0x9,
+    HTTPD_WS_TYPE_PONG = 0xA,
+} httpd_ws_type_t;
+
+typedef struct {
+    bool final;
+    bool fragmented;
+    httpd_ws_type_t type;
+    uint8_t* payload;
+    size_t len;
+} httpd_ws_frame_t;
+
+typedef struct httpd_req {
+    httpd_handle_t handle;
+    int method;
+    char uri[HTTPD_MAX_URI_LEN + 1];
+    size_t content_len;
+    void* aux;
+    void* user_ctx;
+    void* sess_ctx;
+    void (*free_ctx)(void* ctx);
+    bool ignore_sess_ctx_changes;
+
+    // Host only: incoming WS frame / request body and the socket it came on
+    int host_fd;
+    httpd_ws_type_t host_frame_type;
+    const uint8_t* host_frame;
+    size_t host_frame_len;
+    size_t host_body_offset;
+} httpd_req_t;
+
+typedef struct httpd_uri {
+    const char* uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t* r);
+    void* user_ctx;
+    bool is_websocket;
+    bool handle_ws_control_frames;
+    const char* supported_subprotocol;
+} httpd_uri_t;
+
+typedef bool (*httpd_uri_match_func_t)(const char* reference_uri, const char* uri_to_match, size_t match_upto);
+typedef esp_err_t (*httpd_open_func_t)(httpd_handle_t hd, int sockfd);
+typedef void (*httpd_close_func_t)(httpd_handle_t hd, int sockfd);
+
+typedef struct {
+    unsigned task_priority;
+    size_t stack_size;
+    int core_id;
+    uint16_t server_port;
+    uint16_t ctrl_port;
+    uint16_t max_open_sockets;
+    uint16_t max_uri_handlers;
+    uint16_t max_resp_headers;
+    uint16_t backlog_conn;
+    bool lru_purge_enable;
+    uint16_t recv_wait_timeout;
+    uint16_t send_wait_timeout;
+    void* global_user_ctx;
+    void (*global_user_ctx_free_fn)(void* ctx);
+    void* global_transport_ctx;
+    void (*global_transport_ctx_free_fn)(void* ctx);
+    bool enable_so_linger;
+    int linger_timeout;
+    bool keep_alive_enable;
+    int keep_alive_idle;
+    int keep_alive_interval;
+    int keep_alive_count;
+    httpd_open_func_t open_fn;
+    httpd_close_func_t close_fn;
+    httpd_uri_match_func_t uri_match_fn;
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG() {            \
+        .task_priority = 5,                 \
+        .stack_size = 4096,                 \
+        .core_id = 0x7FFFFFFF,              \
+        .server_port = 80,                  \
+        .ctrl_port = 32768,                 \
+        .max_open_sockets = 7,              \
+        .max_uri_handlers = 8,              \
+        .max_resp_headers = 8,              \
+        .backlog_conn = 5,                  \
+        .lru_purge_enable = false,          \
+        .recv_wait_timeout = 5,             \
+        .send_wait_timeout = 5,             \
+        .global_user_ctx = NULL,            \
+        .global_user_ctx_free_fn = NULL,    \
+        .global_transport_ctx = NULL,       \
+        .global_transport_ctx_free_fn = NULL, \
+        .enable_so_linger = false,          \
+        .linger_timeout = 0,                \
+        .keep_alive_enable = false,         \
+        .keep_alive_idle = 0,               \
+        .keep_alive_interval = 0,           \
+        .keep_alive_count = 0,              \
+        .open_fn = NULL,                    \
+        .close_fn = NULL,                   \
+        .uri_match_fn = NULL,               \
+}
+
+bool httpd_uri_match_wildcard(const char* reference_uri, const char* uri_to_match, size_t match_upto);
+
+esp_err_t httpd_start(httpd_handle_t* handle, const httpd_config_t* config);
+esp_err_t httpd_stop(httpd_handle_t handle);
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t* uri_handler);
+
+int httpd_req_to_sockfd(httpd_req_t* r);
+size_t httpd_req_get_hdr_value_len(httpd_req_t* r, const char* field);
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t* r, const char* field, char* val, size_t val_size);
+int httpd_req_recv(httpd_req_t* r, char* buf, size_t buf_len);
+esp_err_t httpd_req_get_url_query_str(httpd_req_t* r, char* buf, size_t buf_len);
+esp_err_t httpd_query_key_value(const char* qry, const char* key, char* val, size_t val_size);
+
+esp_err_t httpd_resp_send(httpd_req_t* r, const char* buf, ssize_t buf_len);
+esp_err_t httpd_resp_send_chunk(httpd_req_t* r, const char* buf, ssize_t buf_len);
+esp_err_t httpd_resp_sendstr_chunk(httpd_req_t* r, const char* str);
+esp_err_t httpd_resp_set_type(httpd_req_t* r, const char* type);
+esp_err_t httpd_resp_set_status(httpd_req_t* r, const char* status);
+esp_err_t httpd_resp_set_hdr(httpd_req_t* r, const char* field, const char* value);
+esp_err_t httpd_resp_send_404(httpd_req_t* r);
+
+typedef enum {
+    HTTPD_400_BAD_REQUEST,
+    HTTPD_404_NOT_FOUND,
+    HTTPD_500_INTERNAL_SERVER_ERROR,
+} httpd_err_code_t;
+
+esp_err_t httpd_resp_send_err(httpd_req_t* r, httpd_err_code_t error, const char* msg);
+
+esp_err_t httpd_ws_recv_frame(httpd_req_t* req, httpd_ws_frame_t* pkt, size_t max_len);
+esp_err_t httpd_ws_send_frame(httpd_req_t* req, httpd_ws_frame_t* pkt);
+
+typedef enum {
+    HTTPD_WS_CLIENT_INVALID = 0x0,
+    HTTPD_WS_CLIENT_HTTP = 0x1,
+    HTTPD_WS_CLIENT_WEBSOCKET = 0x2,
+} httpd_ws_client_info_t;
+
+typedef void (*transfer_complete_cb)(esp_err_t err, int socket, void* arg);
+
+esp_err_t httpd_get_client_list(httpd_handle_t handle, size_t* fds, int* client_fds);
+httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t hd, int fd);
+// Host: recorded, and `callback` runs before returning
+esp_err_t httpd_ws_send_data_async(httpd_handle_t handle, int socket, httpd_ws_frame_t* frame,
+                                   transfer_complete_cb callback, void* arg);
+
+typedef void (*httpd_work_fn_t)(void* arg);
+// Host: runs `work` before returning
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t* frame);
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void* arg);
+
+// Host only: config passed to httpd_start() for the server on `port`, for its
+// open/close callbacks. NULL if none was started there.
+httpd_config_t* host_httpd_config(uint16_t port);
+// Host only: sockets httpd_get_client_list() reports as open WS sessions
+void host_httpd_set_clients(const int* fds, size_t count);
+// Host only: handler registered for `uri` with `method`, or NULL
+const httpd_uri_t* host_httpd_find_handler(const char* uri, httpd_method_t method);
+// Host only: body of the last response / WS frame sent, NUL terminated
+const char* host_httpd_response(void);
+void host_httpd_reset_response(void);
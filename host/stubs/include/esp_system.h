@@ -0,0 +1,5 @@
+#pragma once
+// Host stub
+#include <stdint.h>
+
+uint32_t esp_get_free_heap_size(void);
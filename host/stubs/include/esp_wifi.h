@@ -0,0 +1,18 @@
+#pragma once
+// Host stub: no radio, the AP never has stations
+#include <stdint.h>
+#include "esp_err.h"
+
+#define ESP_WIFI_MAX_CONN_NUM 15
+
+typedef struct {
+    uint8_t mac[6];
+    int8_t rssi;
+} wifi_sta_info_t;
+
+typedef struct {
+    wifi_sta_info_t sta[ESP_WIFI_MAX_CONN_NUM];
+    int num;
+} wifi_sta_list_t;
+
+esp_err_t esp_wifi_ap_get_sta_list(wifi_sta_list_t* sta);
@@ -0,0 +1,40 @@
+#pragma once
+// Host stub: espressif/led_strip 3.x, pixel writes and refreshes are traced
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef struct led_strip_t* led_strip_handle_t;
+
+typedef enum { LED_MODEL_WS2812, LED_MODEL_SK6812 } led_model_t;
+typedef enum { RMT_CLK_SRC_DEFAULT } rmt_clock_source_t;
+
+typedef struct {
+    uint32_t format_id;
+} led_color_component_format_t;
+
+#define LED_STRIP_COLOR_COMPONENT_FMT_GRB (led_color_component_format_t){ 0 }
+#define LED_STRIP_COLOR_COMPONENT_FMT_RGB (led_color_component_format_t){ 1 }
+
+typedef struct {
+    int strip_gpio_num;
+    uint32_t max_leds;
+    led_model_t led_model;
+    led_color_component_format_t color_component_format;
+    struct {
+        uint32_t invert_out: 1;
+    } flags;
+} led_strip_config_t;
+
+typedef struct {
+    rmt_clock_source_t clk_src;
+    uint32_t resolution_hz;
+    size_t mem_block_symbols;
+    struct {
+        uint32_t with_dma: 1;
+    } flags;
+} led_strip_rmt_config_t;
+
+esp_err_t led_strip_new_rmt_device(const led_strip_config_t* led_config, const led_strip_rmt_config_t* rmt_config, led_strip_handle_t* ret_strip);
+esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue);
+esp_err_t led_strip_refresh(led_strip_handle_t strip);
+esp_err_t led_strip_clear(led_strip_handle_t strip);
@@ -0,0 +1,4 @@
+#pragma once
+// Host stub: lwIP's BSD socket API is the host's own
+#include <netinet/in.h>
+#include <sys/socket.h>
@@ -0,0 +1,5 @@
+#pragma once
+// Host stub: ESP32-C6 capabilities
+#define SOC_LEDC_TIMER_BIT_WIDTH 20
+#define SOC_RMT_SUPPORT_DMA      0
+#define SOC_ADC_DIGI_MAX_BITWIDTH 12
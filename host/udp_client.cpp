@@ -0,0 +1,95 @@
+// Linux test client for the UDP control channel: sends a throttle/steering
+// sweep as tagged control datagrams, optionally dropping or swapping
+// packets to exercise the receiver's loss and reorder handling.
+//
+//   udp_client [--host 127.0.0.1] [--port 4210] [--rate 50] [--count 500]
+//              [--loss pct] [--reorder pct] [--key 16-byte-secret]
+#include "includes/command.hpp"
+#include "includes/udp_control.hpp"
+#include <arpa/inet.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// Wall clock, so a restarted client still stamps later than its last run
+static uint32_t now_ms() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+int main(int argc, char** argv) {
+    const char* host = "127.0.0.1";
+    int port = UDP_CONTROL_PORT;
+    int rate = 50;
+    int count = 500;
+    int loss = 0;
+    int reorder = 0;
+    const char* key = "host-loopback-k1";  // udp_receiver's default
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--host") == 0) host = argv[i + 1];
+        else if (strcmp(argv[i], "--port") == 0) port = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--rate") == 0) rate = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--count") == 0) count = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--loss") == 0) loss = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--reorder") == 0) reorder = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--key") == 0) key = argv[i + 1];
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (strlen(key) != CONTROL_UDP_KEY_SIZE || rate <= 0) {
+        fprintf(stderr, "key must be %d bytes, rate positive\n", CONTROL_UDP_KEY_SIZE);
+        return 1;
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (sock < 0 || inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+        fprintf(stderr, "bad host %s\n", host);
+        return 1;
+    }
+
+    srand(1);
+    uint8_t held[CONTROL_UDP_SIZE];
+    bool holding = false;
+    int sent = 0, dropped = 0, swapped = 0;
+    for (int i = 0; i < count; i++) {
+        ControlCommand cmd = {};
+        cmd.seq = (uint16_t)i;
+        cmd.client_ms = now_ms();
+        cmd.throttle = (int16_t)(sin(i * 0.05) * CONTROL_AXIS_MAX);
+        cmd.steering = (int16_t)(cos(i * 0.03) * CONTROL_AXIS_MAX);
+        cmd.flags = CONTROL_FLAG_HEADLIGHTS;
+
+        uint8_t pkt[CONTROL_UDP_SIZE];
+        command_encode_udp(cmd, (const uint8_t*)key, pkt, sizeof(pkt));
+        if (rand() % 100 < loss) {
+            dropped++;
+        } else if (!holding && rand() % 100 < reorder) {
+            // Sent after the next packet, so it arrives late
+            memcpy(held, pkt, sizeof(pkt));
+            holding = true;
+            swapped++;
+        } else {
+            sendto(sock, pkt, sizeof(pkt), 0, (sockaddr*)&addr, sizeof(addr));
+            sent++;
+            if (holding) {
+                sendto(sock, held, sizeof(held), 0, (sockaddr*)&addr, sizeof(addr));
+                sent++;
+                holding = false;
+            }
+        }
+        usleep(1000000 / rate);
+    }
+    close(sock);
+    printf("sent %d, dropped %d, reordered %d\n", sent, dropped, swapped);
+    return 0;
+}
@@ -0,0 +1,65 @@
+// Host build of the UDP control receiver: binds the real socket on
+// loopback and runs the firmware's receive path and control step against
+// the HAL stubs. Drive it with udp_client.
+//
+//   udp_receiver [port] [seconds] [16-byte key]
+//
+// Prints the applied setpoint and the channel stats once a second.
+#include "includes/control_task.hpp"
+#include "includes/led_status.hpp"
+#include "includes/metrics.hpp"
+#include "includes/motor.hpp"
+#include "includes/servo.hpp"
+#include "includes/udp_control.hpp"
+#include "includes/web_server.hpp"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+Motor gMotor(static_cast<gpio_num_t>(19), static_cast<gpio_num_t>(20), static_cast<gpio_num_t>(21), static_cast<gpio_num_t>(22));
+Servo gServo(static_cast<gpio_num_t>(5));
+
+static void print_line(void* ctx, const char* line) {
+    fputs(line, stdout);
+}
+
+int main(int argc, char** argv) {
+    uint16_t port = argc > 1 ? (uint16_t)atoi(argv[1]) : UDP_CONTROL_PORT;
+    int seconds = argc > 2 ? atoi(argv[2]) : 10;
+    // Loopback testing only; the firmware takes CONFIG_ESPDRIVE_UDP_KEY
+    const char* key = argc > 3 ? argv[3] : "host-loopback-k1";
+    if (strlen(key) != CONTROL_UDP_KEY_SIZE) {
+        fprintf(stderr, "key must be %d bytes\n", CONTROL_UDP_KEY_SIZE);
+        return 1;
+    }
+
+    external_strip_init(4, 4);
+    create_lights_task();
+    gMotor.init();
+    gServo.init();
+    start_webserver();
+    if (!udp_control_open(nullptr, port, (const uint8_t*)key)) return 1;
+    printf("listening on udp/%u for %d s\n", port, seconds);
+
+    int64_t end = esp_timer_get_time() + (int64_t)seconds * 1000000;
+    int64_t next_report = esp_timer_get_time() + 1000000;
+    while (esp_timer_get_time() < end) {
+        if (udp_control_poll()) control_step();
+
+        if (esp_timer_get_time() >= next_report) {
+            next_report += 1000000;
+            ControlStatus st = {};
+            control_status(&st);
+            UdpControlStats s = udp_control_stats();
+            printf("seq=%u throttle=%d steering=%d motor=%d | packets=%lu bad_tag=%lu reordered=%lu lost=%lu replayed=%lu rejected=%lu\n",
+                   st.seq, st.throttle, st.steering, st.motor, (unsigned long)s.packets, (unsigned long)s.bad_tag,
+                   (unsigned long)s.reordered, (unsigned long)s.lost, (unsigned long)s.replayed, (unsigned long)s.rejected);
+        }
+    }
+
+    printf("\n/metrics after the run:\n");
+    metrics_format(print_line, nullptr);
+    udp_control_format(print_line, nullptr);
+    return 0;
+}
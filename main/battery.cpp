@@ -0,0 +1,191 @@
+#include "includes/battery.hpp"
+#include "includes/mailbox.hpp"
+#include "includes/tasks.hpp"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <atomic>
+#include <stdio.h>
+
+static const char* TAG = "battery";
+
+// Uncalibrated fallback: nominal full scale at 12 dB
+static constexpr int ADC_FULL_SCALE_MV = 3300;
+static constexpr int ADC_RAW_MAX = 4095;
+
+static adc_continuous_handle_t adc = nullptr;
+static adc_cali_handle_t vbat_cali = nullptr;
+static adc_cali_handle_t current_cali = nullptr;
+static adc_channel_t vbat_chan;
+static adc_channel_t current_chan;
+
+// Battery task only
+static uint8_t frame[BATTERY_FRAME_BYTES];
+static PowerDecimator vbat_dec, current_dec;
+static PowerEma vbat_ema, current_ema;
+static PowerState power_state;
+static int32_t current_ma;
+
+static LatestMailbox<BatteryStatus> status_box;
+
+static std::atomic<uint32_t> stat_frames, stat_overruns, stat_level_changes;
+static std::atomic<uint16_t> stat_vbat_min{0xFFFF};
+static std::atomic<int16_t> stat_current_max{0};
+
+static bool pool_overflow(adc_continuous_handle_t handle, const adc_continuous_evt_data_t* edata, void* user_data) {
+    stat_overruns.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+static adc_cali_handle_t calibration(adc_channel_t chan) {
+    adc_cali_handle_t cali = nullptr;
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    adc_cali_curve_fitting_config_t cfg = {};
+    cfg.unit_id = ADC_UNIT_1;
+    cfg.chan = chan;
+    cfg.atten = ADC_ATTEN_DB_12;
+    cfg.bitwidth = ADC_BITWIDTH_DEFAULT;
+    if (adc_cali_create_scheme_curve_fitting(&cfg, &cali) != ESP_OK) cali = nullptr;
+#endif
+    if (!cali) ESP_LOGW(TAG, "No eFuse calibration for channel %d, using nominal scale", chan);
+    return cali;
+}
+
+// Calibration runs once per decimated block, not per sample
+static int32_t pin_mv(adc_cali_handle_t cali, uint16_t raw) {
+    int mv;
+    if (cali && adc_cali_raw_to_voltage(cali, raw, &mv) == ESP_OK) return mv;
+    return (int32_t)raw * ADC_FULL_SCALE_MV / ADC_RAW_MAX;
+}
+
+static void publish(int32_t vbat_mv) {
+    PowerLevel prev = power_state.level;
+    PowerLevel level = power_level_update(&power_state, vbat_mv, (uint32_t)(esp_timer_get_time() / 1000));
+    if (level != prev) {
+        stat_level_changes.fetch_add(1, std::memory_order_relaxed);
+        ESP_LOGW(TAG, "Battery %ld mV: %s", (long)vbat_mv, power_level_name(level));
+    }
+
+    BatteryStatus status;
+    status.vbat_mv = (uint16_t)vbat_mv;
+    status.current_ma = (int16_t)current_ma;
+    status.level = level;
+    status.limit = power_limit_for(level);
+    status_box.publish(status);
+
+    if (status.vbat_mv < stat_vbat_min.load(std::memory_order_relaxed)) {
+        stat_vbat_min.store(status.vbat_mv, std::memory_order_relaxed);
+    }
+    if (status.current_ma > stat_current_max.load(std::memory_order_relaxed)) {
+        stat_current_max.store(status.current_ma, std::memory_order_relaxed);
+    }
+}
+
+bool battery_open() {
+    adc_unit_t unit;
+    if (adc_continuous_io_to_channel(BATTERY_VBAT_GPIO, &unit, &vbat_chan) != ESP_OK || unit != ADC_UNIT_1 ||
+        adc_continuous_io_to_channel(BATTERY_CURRENT_GPIO, &unit, &current_chan) != ESP_OK || unit != ADC_UNIT_1) {
+        ESP_LOGE(TAG, "GPIO %d/%d are not ADC1 pins", BATTERY_VBAT_GPIO, BATTERY_CURRENT_GPIO);
+        return false;
+    }
+
+    adc_continuous_handle_cfg_t handle_cfg = {};
+    handle_cfg.max_store_buf_size = BATTERY_POOL_BYTES;
+    handle_cfg.conv_frame_size = BATTERY_FRAME_BYTES;
+    esp_err_t err = adc_continuous_new_handle(&handle_cfg, &adc);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ADC continuous mode unavailable (err=%d)", err);
+        return false;
+    }
+
+    adc_digi_pattern_config_t pattern[2] = {};
+    const adc_channel_t chans[2] = { vbat_chan, current_chan };
+    for (int i = 0; i < 2; i++) {
+        pattern[i].atten = ADC_ATTEN_DB_12;
+        pattern[i].channel = chans[i];
+        pattern[i].unit = ADC_UNIT_1;
+        pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    }
+    adc_continuous_config_t cfg = {};
+    cfg.pattern_num = 2;
+    cfg.adc_pattern = pattern;
+    cfg.sample_freq_hz = BATTERY_SAMPLE_HZ;
+    cfg.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    cfg.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+    ESP_ERROR_CHECK(adc_continuous_config(adc, &cfg));
+
+    adc_continuous_evt_cbs_t cbs = {};
+    cbs.on_pool_ovf = pool_overflow;
+    ESP_ERROR_CHECK(adc_continuous_register_event_callbacks(adc, &cbs, nullptr));
+
+    vbat_cali = calibration(vbat_chan);
+    current_cali = calibration(current_chan);
+    ESP_ERROR_CHECK(adc_continuous_start(adc));
+    ESP_LOGI(TAG, "Sampling GPIO %d (battery) and %d (current) at %u Hz", BATTERY_VBAT_GPIO,
+             BATTERY_CURRENT_GPIO, (unsigned int)BATTERY_SAMPLE_HZ);
+    return true;
+}
+
+bool battery_poll() {
+    uint32_t len = 0;
+    if (adc_continuous_read(adc, frame, sizeof(frame), &len, BATTERY_POLL_MS) != ESP_OK) return false;
+    stat_frames.fetch_add(1, std::memory_order_relaxed);
+
+    for (uint32_t i = 0; i + sizeof(adc_digi_output_data_t) <= len; i += sizeof(adc_digi_output_data_t)) {
+        const adc_digi_output_data_t* d = (const adc_digi_output_data_t*)&frame[i];
+        uint16_t raw = (uint16_t)ADC_GET_DATA(d);
+        uint16_t avg;
+        if (ADC_GET_CHANNEL(d) == (uint32_t)current_chan) {
+            if (power_decimate(&current_dec, raw, &avg)) {
+                current_ma = power_ema(&current_ema, pin_mv(current_cali, avg) * 1000 / BATTERY_CURRENT_MV_PER_A);
+            }
+        } else if (ADC_GET_CHANNEL(d) == (uint32_t)vbat_chan) {
+            if (power_decimate(&vbat_dec, raw, &avg)) {
+                publish(power_ema(&vbat_ema, pin_mv(vbat_cali, avg) * BATTERY_DIVIDER_MUL));
+            }
+        }
+    }
+    return true;
+}
+
+static void battery_task(void* param) {
+    while (true) battery_poll();
+}
+
+void battery_start() {
+    if (!battery_open()) return;
+    // Below the control task and httpd; the DMA pool covers ~100 ms of lag
+    static TaskStorage<3072> storage;
+    task_spawn(battery_task, "battery", NULL, 3, storage);
+}
+
+bool battery_status(BatteryStatus* out) {
+    return status_box.peek(out);
+}
+
+BatteryStats battery_stats() {
+    BatteryStats s;
+    s.frames = stat_frames.load(std::memory_order_relaxed);
+    s.overruns = stat_overruns.load(std::memory_order_relaxed);
+    s.level_changes = stat_level_changes.load(std::memory_order_relaxed);
+    s.vbat_min_mv = stat_vbat_min.load(std::memory_order_relaxed);
+    s.current_max_ma = stat_current_max.load(std::memory_order_relaxed);
+    return s;
+}
+
+void battery_format(metrics_emit_fn emit, void* ctx) {
+    if (!adc) return;
+    BatteryStatus status;
+    if (!battery_status(&status)) return;
+    BatteryStats s = battery_stats();
+    char line[192];
+    snprintf(line, sizeof(line),
+             "battery vbat_mv=%u current_ma=%d level=%s max_speed=%u vbat_min_mv=%u current_max_ma=%d "
+             "frames=%lu overruns=%lu level_changes=%lu\n",
+             status.vbat_mv, status.current_ma, power_level_name(status.level), status.limit.max_speed,
+             s.vbat_min_mv, s.current_max_ma, (unsigned long)s.frames, (unsigned long)s.overruns,
+             (unsigned long)s.level_changes);
+    emit(ctx, line);
+}
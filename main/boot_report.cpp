@@ -0,0 +1,62 @@
+#include "includes/boot_report.hpp"
+#include "includes/event_log.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <atomic>
+#include <stdio.h>
+
+static const char* TAG = "boot";
+
+// us, 0 until stamped
+static std::atomic<uint32_t> stamps[BOOT_PHASE_COUNT];
+
+static const char* const phase_names[BOOT_PHASE_COUNT] = {
+    "app_main",
+    "nvs",
+    "netif",
+    "peripherals",
+    "httpd",
+    "ap_started",
+    "assets",
+    "first_client",
+    "first_command",
+};
+
+void boot_mark(BootPhase phase) {
+    if (stamps[phase].load(std::memory_order_relaxed) != 0) return;
+
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    uint32_t expected = 0;
+    if (!stamps[phase].compare_exchange_strong(expected, now ? now : 1, std::memory_order_relaxed)) return;
+    // Printing is left to the event log task, this may be on the control path
+    if (phase == BOOT_FIRST_COMMAND) event_log(EVT_BOOT_REPORT);
+}
+
+static void format_line(char* line, size_t size) {
+    int len = 0;
+    line[0] = '\0';
+    for (int i = 0; i < BOOT_PHASE_COUNT && len < (int)size; i++) {
+        uint32_t us = stamps[i].load(std::memory_order_relaxed);
+        if (us) {
+            len += snprintf(line + len, size - len, "%s%s=%lu", i ? " " : "", phase_names[i], (unsigned long)(us / 1000));
+        } else {
+            len += snprintf(line + len, size - len, "%s%s=-", i ? " " : "", phase_names[i]);
+        }
+    }
+}
+
+void boot_report_log() {
+    char line[192];
+    format_line(line, sizeof(line));
+    ESP_LOGI(TAG, "phases (ms): %s", line);
+}
+
+void boot_format(metrics_emit_fn emit, void* ctx) {
+    char line[64];
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        uint32_t us = stamps[i].load(std::memory_order_relaxed);
+        if (!us) continue;
+        snprintf(line, sizeof(line), "boot_%s_ms %lu\n", phase_names[i], (unsigned long)(us / 1000));
+        emit(ctx, line);
+    }
+}
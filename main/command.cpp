@@ -0,0 +1,230 @@
+#include "includes/command.hpp"
+#include <stdlib.h>
+#include <string.h>
+
+static inline uint16_t read_u16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline void write_u16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline uint32_t read_u32(const uint8_t* p) {
+    return (uint32_t)read_u16(p) | ((uint32_t)read_u16(p + 2) << 16);
+}
+
+static inline void write_u32(uint8_t* p, uint32_t v) {
+    write_u16(p, (uint16_t)(v & 0xFFFF));
+    write_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static inline int16_t clamp_axis(int16_t v) {
+    // -32768 has no positive counterpart, keep the range symmetric
+    return v < -CONTROL_AXIS_MAX ? -CONTROL_AXIS_MAX : v;
+}
+
+bool command_decode_binary(const uint8_t* buf, size_t len, ControlCommand* out) {
+    if (!buf || !out) return false;
+    if (!(len == CONTROL_FRAME_SIZE && buf[0] == CONTROL_FRAME_VERSION) &&
+        !(len == CONTROL_FRAME_V1_SIZE && buf[0] == 1)) {
+        return false;
+    }
+
+    out->kind = CMD_DRIVE;
+    out->flags = buf[1];
+    out->seq = read_u16(buf + 2);
+    out->has_seq = true;
+    out->value = 0;
+    out->throttle = clamp_axis((int16_t)read_u16(buf + 4));
+    out->steering = clamp_axis((int16_t)read_u16(buf + 6));
+    out->has_time = len == CONTROL_FRAME_SIZE;
+    out->client_ms = out->has_time ? read_u32(buf + 8) : 0;
+    return true;
+}
+
+size_t command_encode_binary(const ControlCommand& cmd, uint8_t* buf, size_t len) {
+    if (!buf || len < CONTROL_FRAME_SIZE) return 0;
+
+    buf[0] = CONTROL_FRAME_VERSION;
+    buf[1] = cmd.flags;
+    write_u16(buf + 2, cmd.seq);
+    write_u16(buf + 4, (uint16_t)cmd.throttle);
+    write_u16(buf + 6, (uint16_t)cmd.steering);
+    write_u32(buf + 8, cmd.client_ms);
+    return CONTROL_FRAME_SIZE;
+}
+
+static inline uint64_t rotl64(uint64_t v, int n) {
+    return (v << n) | (v >> (64 - n));
+}
+
+static inline uint64_t read_u64(const uint8_t* p) {
+    return (uint64_t)read_u32(p) | ((uint64_t)read_u32(p + 4) << 32);
+}
+
+static inline void sip_round(uint64_t v[4]) {
+    v[0] += v[1]; v[1] = rotl64(v[1], 13); v[1] ^= v[0]; v[0] = rotl64(v[0], 32);
+    v[2] += v[3]; v[3] = rotl64(v[3], 16); v[3] ^= v[2];
+    v[0] += v[3]; v[3] = rotl64(v[3], 21); v[3] ^= v[0];
+    v[2] += v[1]; v[1] = rotl64(v[1], 17); v[1] ^= v[2]; v[2] = rotl64(v[2], 32);
+}
+
+// SipHash-2-4, 64-bit output
+static uint64_t siphash(const uint8_t* key, const uint8_t* data, size_t len) {
+    uint64_t k0 = read_u64(key);
+    uint64_t k1 = read_u64(key + 8);
+    uint64_t v[4] = { k0 ^ 0x736f6d6570736575ULL, k1 ^ 0x646f72616e646f6dULL,
+                      k0 ^ 0x6c7967656e657261ULL, k1 ^ 0x7465646279746573ULL };
+
+    const uint8_t* end = data + (len & ~(size_t)7);
+    for (; data != end; data += 8) {
+        uint64_t m = read_u64(data);
+        v[3] ^= m;
+        sip_round(v);
+        sip_round(v);
+        v[0] ^= m;
+    }
+    uint64_t last = (uint64_t)len << 56;
+    for (size_t i = 0; i < (len & 7); i++) last |= (uint64_t)data[i] << (8 * i);
+    v[3] ^= last;
+    sip_round(v);
+    sip_round(v);
+    v[0] ^= last;
+
+    v[2] ^= 0xFF;
+    for (int i = 0; i < 4; i++) sip_round(v);
+    return v[0] ^ v[1] ^ v[2] ^ v[3];
+}
+
+size_t command_encode_udp(const ControlCommand& cmd, const uint8_t* key, uint8_t* buf, size_t len) {
+    if (!key || len < CONTROL_UDP_SIZE) return 0;
+    command_encode_binary(cmd, buf, len);
+    write_u32(buf + CONTROL_FRAME_SIZE, (uint32_t)siphash(key, buf, CONTROL_FRAME_SIZE));
+    return CONTROL_UDP_SIZE;
+}
+
+bool command_decode_udp(const uint8_t* buf, size_t len, const uint8_t* key, ControlCommand* out) {
+    if (!buf || !key || len != CONTROL_UDP_SIZE) return false;
+    // Every byte is compared, so timing says nothing about how much matched
+    uint32_t diff = read_u32(buf + CONTROL_FRAME_SIZE) ^ (uint32_t)siphash(key, buf, CONTROL_FRAME_SIZE);
+    if (diff != 0) return false;
+    return command_decode_binary(buf, CONTROL_FRAME_SIZE, out);
+}
+
+void command_merge(ControlCommand* setpoint, const ControlCommand& cmd) {
+    // Legacy fwd/rev speed is 0-255
+    int value = cmd.value < 0 ? 0 : (cmd.value > 255 ? 255 : cmd.value);
+    int16_t speed = (int16_t)(value * CONTROL_AXIS_MAX / 255);
+
+    switch (cmd.kind) {
+        case CMD_FWD:    setpoint->throttle = speed; break;
+        case CMD_REV:    setpoint->throttle = -speed; break;
+        case CMD_STOP:   setpoint->throttle = 0; break;
+        case CMD_LEFT:   setpoint->steering = -CONTROL_AXIS_MAX; break;
+        case CMD_RIGHT:  setpoint->steering = CONTROL_AXIS_MAX; break;
+        case CMD_CENTER: setpoint->steering = 0; break;
+        case CMD_DRIVE:
+            setpoint->throttle = cmd.throttle;
+            setpoint->steering = cmd.steering;
+            setpoint->flags = cmd.flags;
+            break;
+        default:
+            return;
+    }
+    setpoint->kind = CMD_DRIVE;
+    setpoint->seq = cmd.seq;
+    setpoint->rx_us = cmd.rx_us;
+    setpoint->parsed_us = cmd.parsed_us;
+}
+
+static const char* skip_space(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+    return p;
+}
+
+static bool key_is(const char* key, size_t len, const char* name) {
+    return strlen(name) == len && memcmp(key, name, len) == 0;
+}
+
+bool command_counter_from_double(double v, uint64_t* out) {
+    // Written so NaN fails too
+    if (!(v >= 0.0 && v <= 9007199254740992.0)) return false;
+    *out = (uint64_t)v;
+    return true;
+}
+
+static int16_t axis_from_double(double v) {
+    if (v > 1.0) v = 1.0;
+    if (v < -1.0) v = -1.0;
+    return (int16_t)(v * CONTROL_AXIS_MAX);
+}
+
+bool command_decode_setpoint(const char* buf, size_t len, ControlCommand* out) {
+    if (!buf || !out) return false;
+    const char* end = buf + len;
+    const char* p = skip_space(buf, end);
+    if (p == end || *p++ != '{') return false;
+
+    memset(out, 0, sizeof(*out));
+    out->kind = CMD_DRIVE;
+    p = skip_space(p, end);
+    if (p < end && *p == '}') return true;
+
+    while (p < end) {
+        // "key"
+        if (*p++ != '"') return false;
+        const char* key = p;
+        while (p < end && *p != '"') p++;
+        if (p == end) return false;
+        size_t key_len = (size_t)(p - key);
+        p = skip_space(p + 1, end);
+        if (p == end || *p++ != ':') return false;
+        p = skip_space(p, end);
+
+        // true / false / number
+        bool is_bool = false;
+        bool flag = false;
+        double number = 0;
+        uint64_t counter;
+        if (end - p >= 4 && memcmp(p, "true", 4) == 0) {
+            is_bool = flag = true;
+            p += 4;
+        } else if (end - p >= 5 && memcmp(p, "false", 5) == 0) {
+            is_bool = true;
+            p += 5;
+        } else {
+            // strtod needs a terminator the body doesn't have
+            char num[24];
+            size_t n = 0;
+            while (p + n < end && n < sizeof(num) - 1 && strchr("+-.0123456789eE", p[n])) n++;
+            if (n == 0) return false;
+            memcpy(num, p, n);
+            num[n] = '\0';
+            char* num_end;
+            number = strtod(num, &num_end);
+            if (num_end != num + n) return false;
+            p += n;
+        }
+
+        if (key_is(key, key_len, "throttle") && !is_bool) out->throttle = axis_from_double(number);
+        else if (key_is(key, key_len, "steering") && !is_bool) out->steering = axis_from_double(number);
+        else if (key_is(key, key_len, "headlights") && flag) out->flags |= CONTROL_FLAG_HEADLIGHTS;
+        else if (key_is(key, key_len, "horn") && flag) out->flags |= CONTROL_FLAG_HORN;
+        else if (key_is(key, key_len, "seq") && !is_bool && command_counter_from_double(number, &counter)) {
+            out->seq = (uint16_t)(counter & 0xFFFF);
+            out->has_seq = true;
+        } else if (key_is(key, key_len, "ts") && !is_bool && command_counter_from_double(number, &counter)) {
+            out->client_ms = (uint32_t)counter;
+            out->has_time = true;
+        }
+
+        p = skip_space(p, end);
+        if (p == end) return false;
+        if (*p == '}') return true;
+        if (*p++ != ',') return false;
+        p = skip_space(p, end);
+    }
+    return false;
+}
@@ -0,0 +1,116 @@
+#include "includes/command.hpp"
+#include "includes/metrics.hpp"
+#include "cJSON.h"
+#include <string.h>
+
+#ifdef STATIC_ALLOCATION
+// cJSON allocates from a fixed arena instead of the heap: bump allocation,
+// free is a no-op, and the arena is reset before each parse. Frames are
+// decoded on the control server's task only. The hooks are global, nothing
+// else in the firmware uses cJSON.
+#define JSON_ARENA_SIZE 4096
+
+alignas(8) static uint8_t json_arena[JSON_ARENA_SIZE];
+static size_t json_arena_used;
+static bool json_hooks_installed;
+
+static void* json_arena_malloc(size_t size) {
+    size = (size + 7) & ~(size_t)7;
+    if (size > JSON_ARENA_SIZE - json_arena_used) {
+        metrics_count(METRIC_MALLOC_FAILURES);
+        return NULL;    // parse fails cleanly
+    }
+    void* p = json_arena + json_arena_used;
+    json_arena_used += size;
+    return p;
+}
+
+static void json_arena_free(void* p) {}
+
+static void json_arena_reset() {
+    if (!json_hooks_installed) {
+        cJSON_Hooks hooks = { json_arena_malloc, json_arena_free };
+        cJSON_InitHooks(&hooks);
+        json_hooks_installed = true;
+    }
+    json_arena_used = 0;
+}
+#endif
+
+static ControlCommandKind command_from_string(const char* command) {
+    if (strcmp(command, "fwd") == 0) return CMD_FWD;
+    if (strcmp(command, "rev") == 0) return CMD_REV;
+    if (strcmp(command, "left") == 0) return CMD_LEFT;
+    if (strcmp(command, "right") == 0) return CMD_RIGHT;
+    if (strcmp(command, "center") == 0) return CMD_CENTER;
+    if (strcmp(command, "stop") == 0) return CMD_STOP;
+    return CMD_NONE;
+}
+
+static int16_t axis_from_json(const cJSON* item) {
+    if (!item || !cJSON_IsNumber(item)) return 0;
+    double v = item->valuedouble;
+    if (v > 1.0) v = 1.0;
+    if (v < -1.0) v = -1.0;
+    return (int16_t)(v * CONTROL_AXIS_MAX);
+}
+
+// {"type":"rc_command","payload":{"throttle":0.4,"steering":-1,"headlights":true,"horn":false,"seq":12,"ts":81234}}
+static bool decode_rc_command(const cJSON* payload, ControlCommand* out) {
+    if (!payload || !cJSON_IsObject(payload)) return false;
+
+    out->kind = CMD_DRIVE;
+    out->throttle = axis_from_json(cJSON_GetObjectItem(payload, "throttle"));
+    out->steering = axis_from_json(cJSON_GetObjectItem(payload, "steering"));
+    if (cJSON_IsTrue(cJSON_GetObjectItem(payload, "headlights"))) out->flags |= CONTROL_FLAG_HEADLIGHTS;
+    if (cJSON_IsTrue(cJSON_GetObjectItem(payload, "horn"))) out->flags |= CONTROL_FLAG_HORN;
+
+    uint64_t counter;
+    const cJSON* seq = cJSON_GetObjectItem(payload, "seq");
+    if (seq && cJSON_IsNumber(seq) && command_counter_from_double(seq->valuedouble, &counter)) {
+        out->seq = (uint16_t)(counter & 0xFFFF);
+        out->has_seq = true;
+    }
+    const cJSON* ts = cJSON_GetObjectItem(payload, "ts");
+    if (ts && cJSON_IsNumber(ts) && command_counter_from_double(ts->valuedouble, &counter)) {
+        out->client_ms = (uint32_t)counter;
+        out->has_time = true;
+    }
+    return true;
+}
+
+bool command_decode_json(const char* buf, size_t len, ControlCommand* out) {
+    if (!buf || !out) return false;
+
+#ifdef STATIC_ALLOCATION
+    json_arena_reset();
+#endif
+    cJSON *root = cJSON_ParseWithLength(buf, len);
+    if (!root) return false;
+
+    cJSON *typeItem = cJSON_GetObjectItem(root, "type");
+    if (!typeItem || !cJSON_IsString(typeItem)) {
+        cJSON_Delete(root);
+        return false;
+    }
+
+    memset(out, 0, sizeof(*out));
+    bool ok = false;
+    if (strcmp(typeItem->valuestring, "rc_command") == 0) {
+        ok = decode_rc_command(cJSON_GetObjectItem(root, "payload"), out);
+    } else {
+        cJSON *commandItem = cJSON_GetObjectItem(root, "command");
+        cJSON *valueItem = cJSON_GetObjectItem(root, "value");
+        if (commandItem && cJSON_IsString(commandItem)) {
+            out->kind = command_from_string(commandItem->valuestring);
+            out->value = 200;
+            if (valueItem && cJSON_IsNumber(valueItem)) {
+                out->value = valueItem->valueint;
+            }
+            ok = true;
+        }
+    }
+
+    cJSON_Delete(root);
+    return ok;
+}
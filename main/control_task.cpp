@@ -0,0 +1,157 @@
+#include "includes/control_task.hpp"
+#include "includes/controls.hpp"
+#include "includes/mailbox.hpp"
+#include "includes/metrics.hpp"
+#include "includes/motor.hpp"
+#include "includes/recorder.hpp"
+#include "includes/scheduler.hpp"
+#include "includes/servo.hpp"
+#include "includes/tasks.hpp"
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char* TAG = "control_task";
+
+extern Motor gMotor;
+extern Servo gServo;
+
+// Commands as published. Only the control task folds them into the
+// setpoint: a producer-side peek/merge/publish could be interleaved by
+// another producer and republish a stale setpoint over a STOP. Full
+// CMD_DRIVE setpoints and the two legacy axes each get a latest-wins box,
+// so "fwd" then "left" within one tick keeps both; `order` merges what
+// was taken in publish order.
+struct PublishedCommand {
+    ControlCommand cmd;
+    uint32_t order;
+};
+
+enum CommandBox { BOX_DRIVE, BOX_THROTTLE, BOX_STEERING, BOX_COUNT };
+
+static LatestMailbox<PublishedCommand> boxes[BOX_COUNT];
+static std::atomic<uint32_t> publish_order{0};
+static LatestMailbox<ControlStatus> status_box;
+static ControlCommand applied_setpoint = {};    // control task only
+static TaskHandle_t control_task_handle = nullptr;
+static esp_timer_handle_t control_timer = nullptr;
+
+static void publish(const ControlCommand& cmd) {
+    CommandBox box;
+    switch (cmd.kind) {
+        case CMD_DRIVE:  box = BOX_DRIVE; break;
+        case CMD_FWD:
+        case CMD_REV:
+        case CMD_STOP:   box = BOX_THROTTLE; break;
+        case CMD_LEFT:
+        case CMD_RIGHT:
+        case CMD_CENTER: box = BOX_STEERING; break;
+        default:         return;
+    }
+    PublishedCommand p = { cmd, publish_order.fetch_add(1, std::memory_order_relaxed) + 1 };
+    boxes[box].publish(p);
+}
+
+void control_publish(const ControlCommand& cmd) {
+    // A live command takes the car back from a running replay or maneuver
+    if (recorder_replaying()) recorder_replay_stop();
+    if (scheduler_running()) scheduler_abort(SCHEDULE_ABORT_LIVE);
+
+    publish(cmd);
+}
+
+void control_replace(const ControlCommand& setpoint) {
+    publish(setpoint);
+}
+
+static void control_tick(void* arg) {
+    xTaskNotifyGive(control_task_handle);
+}
+
+void control_kick() {
+    if (control_task_handle) xTaskNotifyGive(control_task_handle);
+}
+
+void control_step() {
+    uint32_t start_us = (uint32_t)esp_timer_get_time();
+    PublishedCommand taken[BOX_COUNT];
+    size_t count = 0;
+    uint32_t skipped = 0;
+    for (size_t b = 0; b < BOX_COUNT; b++) {
+        uint32_t box_skipped = 0;
+        if (!boxes[b].take(&taken[count], &box_skipped)) continue;
+        skipped += box_skipped;
+        // Insert in publish order (wrapping)
+        size_t i = count++;
+        for (; i > 0 && (int32_t)(taken[i].order - taken[i - 1].order) < 0; i--) {
+            PublishedCommand t = taken[i];
+            taken[i] = taken[i - 1];
+            taken[i - 1] = t;
+        }
+    }
+    if (count) {
+        ControlCommand setpoint = applied_setpoint;
+        if (setpoint.kind != CMD_DRIVE) {
+            // Legacy commands never carry flags, keep headlights on for them
+            setpoint.kind = CMD_DRIVE;
+            setpoint.flags = CONTROL_FLAG_HEADLIGHTS;
+        }
+        for (size_t i = 0; i < count; i++) {
+            command_merge(&setpoint, taken[i].cmd);
+        }
+        uint32_t dispatch_us = (uint32_t)esp_timer_get_time();
+        if (skipped) metrics_count(METRIC_DROPPED_FRAMES, skipped);
+        recorder_record(setpoint, dispatch_us);
+
+        drive(setpoint.throttle, setpoint.steering, setpoint.flags);
+        applied_setpoint = setpoint;
+        scheduler_applied(setpoint);
+
+        if (setpoint.rx_us) {
+            uint32_t pwm_us = (uint32_t)esp_timer_get_time();
+            metrics_latency(STAGE_QUEUE, dispatch_us - setpoint.parsed_us);
+            metrics_latency(STAGE_ACTUATE, pwm_us - dispatch_us);
+            metrics_latency(STAGE_TOTAL, pwm_us - setpoint.rx_us);
+        }
+    }
+    controls_update();
+
+    ControlStatus status = {};
+    status.seq = applied_setpoint.seq;
+    status.flags = applied_setpoint.flags;
+    status.throttle = applied_setpoint.throttle;
+    status.steering = applied_setpoint.steering;
+    uint32_t max_duty = gMotor.maxDuty();
+    status.motor = max_duty ? (int16_t)((int64_t)gMotor.appliedDuty() * CONTROL_AXIS_MAX / max_duty) : 0;
+    status.servo = (int16_t)gServo.position();
+    status.loop_us = (uint16_t)((uint32_t)esp_timer_get_time() - start_us);
+    status_box.publish(status);
+}
+
+bool control_status(ControlStatus* out) {
+    return status_box.peek(out);
+}
+
+void control_task_run(uint32_t rate_hz) {
+    control_task_handle = xTaskGetCurrentTaskHandle();
+    task_register(control_task_handle);
+    vTaskPrioritySet(nullptr, CONTROL_TASK_PRIORITY);
+
+    // esp_timer instead of vTaskDelayUntil, the tick rate is too coarse for 200 Hz
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = control_tick;
+    timer_args.name = "control_tick";
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &control_timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(control_timer, 1000000 / rate_hz));
+
+    ESP_LOGI(TAG, "Control loop running at %u Hz", (unsigned int)rate_hz);
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        uint32_t allocs = task_alloc_count();
+        control_step();
+        task_alloc_check(allocs);
+    }
+}
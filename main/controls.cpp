@@ -1,20 +1,45 @@
 #include "includes/controls.hpp"
+#include "includes/command.hpp"
 #include "includes/motor.hpp"
 #include "includes/servo.hpp"
 #include "includes/led_status.hpp"
+#include "includes/battery.hpp"
 #include "esp_err.h"
+#include "esp_timer.h"
+#include <stdio.h>
 
 extern Motor gMotor;
 extern Servo gServo;
 
+static constexpr int STEER_INDICATOR_THRESHOLD = CONTROL_AXIS_MAX / 3;
+
+static AxisShape throttle_shape = { CONTROL_AXIS_MAX / 20, 30 };
+static AxisShape steering_shape = { CONTROL_AXIS_MAX / 33, 20 };
+
+// Speed loop, control task only once set
+static int32_t (*speed_counts)(void) = nullptr;
+static uint32_t speed_counts_per_m;
+static SpeedPid speed_pid;
+static SpeedEstimate speed_est;
+static int32_t target_mmps;
+static int32_t measured_mmps;
+static uint32_t last_loop_us;
+
+// Legacy 0-255 speed to Motor's normalized 16-bit speed
+static uint16_t legacy_speed(int speed) {
+    if (speed < 0) speed = 0;
+    if (speed > 255) speed = 255;
+    return (uint16_t)(speed * MOTOR_SPEED_MAX / 255);
+}
+
 esp_err_t forward(int speed) {
     set_vehicle_lights(NORMAL);
-    gMotor.forward(speed);
+    gMotor.forward(legacy_speed(speed));
     return ESP_OK;
 }
 esp_err_t reverse(int speed) {
     set_vehicle_lights(REVERSING);
-    gMotor.reverse(speed);
+    gMotor.reverse(legacy_speed(speed));
     return ESP_OK;
 }
 esp_err_t stop() {
@@ -25,17 +50,93 @@ esp_err_t stop() {
 esp_err_t left() {
     // led_status_blink(255, 255, 0, 3, 500);
     set_vehicle_lights(STEERING_LEFT);
-    gServo.writeAngle(30);
+    gServo.writePosition(-CONTROL_AXIS_MAX);
     return ESP_OK;
 }
 esp_err_t right() {
     // led_status_blink(255, 255, 0, 3, 500);
     set_vehicle_lights(STEERING_RIGHT);
-    gServo.writeAngle(150);
+    gServo.writePosition(CONTROL_AXIS_MAX);
     return ESP_OK;
 }
 esp_err_t center() {
     set_vehicle_lights(NORMAL);
-    gServo.writeAngle(90);
+    gServo.writePosition(0);
     return ESP_OK;
-}
\ No newline at end of file
+}
+
+esp_err_t drive(int throttle, int steering, uint8_t flags) {
+    throttle = axis_shape(throttle, throttle_shape);
+    steering = axis_shape(steering, steering_shape);
+
+    // One light update for both axes; layers combine (reversing + indicator)
+    lights_set_drive((flags & CONTROL_FLAG_HEADLIGHTS) != 0, throttle == 0, throttle < 0,
+                     steering <= -STEER_INDICATOR_THRESHOLD ? -1 : (steering >= STEER_INDICATOR_THRESHOLD ? 1 : 0));
+
+    if (speed_counts) {
+        // controls_update() turns it into duty
+        target_mmps = (int32_t)((int64_t)throttle * SPEED_MAX_MMPS / CONTROL_AXIS_MAX);
+        gServo.writePosition(steering);
+        return ESP_OK;
+    }
+
+    uint16_t speed = (uint16_t)((int64_t)(throttle < 0 ? -throttle : throttle) * MOTOR_SPEED_MAX / CONTROL_AXIS_MAX);
+    if (throttle > 0) {
+        gMotor.forward(speed);
+    } else if (throttle < 0) {
+        gMotor.reverse(speed);
+    } else {
+        gMotor.stop();
+    }
+
+    gServo.writePosition(steering);
+    return ESP_OK;
+}
+
+void controls_update() {
+    // Battery protection, latest filtered level (no-op when unchanged)
+    BatteryStatus battery;
+    if (battery_status(&battery)) {
+        gMotor.setPowerLimit(battery.limit);
+        speed_pid.out_max = battery.limit.max_speed;
+    }
+    if (speed_counts) {
+        uint32_t now_us = (uint32_t)esp_timer_get_time();
+        measured_mmps = speed_estimate(&speed_est, speed_counts(), now_us, speed_counts_per_m);
+        uint32_t dt_us = last_loop_us ? now_us - last_loop_us : 0;
+        last_loop_us = now_us;
+        int32_t out = speed_pid_step(&speed_pid, target_mmps, measured_mmps, dt_us);
+        if (out == 0) gMotor.stop();
+        else gMotor.driveNow(out);
+    }
+    gMotor.update();
+}
+
+void controls_set_speed_loop(int32_t (*read_counts)(void), uint32_t counts_per_m, const SpeedGains* gains) {
+    speed_pid_init(&speed_pid, gains ? *gains : SPEED_GAINS_DEFAULT);
+    speed_est = {};
+    speed_counts_per_m = counts_per_m;
+    target_mmps = 0;
+    measured_mmps = 0;
+    last_loop_us = 0;
+    speed_counts = read_counts;
+}
+
+void controls_format(metrics_emit_fn emit, void* ctx) {
+    if (!speed_counts) return;
+    char line[128];
+    snprintf(line, sizeof(line), "speed target_mmps=%ld setpoint_mmps=%ld measured_mmps=%ld out=%ld\n",
+             (long)target_mmps, (long)speed_pid.setpoint, (long)measured_mmps, (long)speed_pid.out);
+    emit(ctx, line);
+}
+
+esp_err_t controls_set_shape(ControlAxis axis, AxisShape shape) {
+    if (shape.deadband < 0 || shape.deadband >= CONTROL_AXIS_MAX || shape.expo < 0 || shape.expo > 100) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    switch (axis) {
+        case AXIS_THROTTLE: throttle_shape = shape; return ESP_OK;
+        case AXIS_STEERING: steering_shape = shape; return ESP_OK;
+        default:            return ESP_ERR_INVALID_ARG;
+    }
+}
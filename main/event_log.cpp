@@ -0,0 +1,96 @@
+#include "includes/event_log.hpp"
+#include "includes/boot_report.hpp"
+#include "includes/tasks.hpp"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include <atomic>
+
+static const char* TAG = "event_log";
+
+struct EventRecord {
+    std::atomic<uint32_t> seq;  // index + 1 once the record is complete
+    uint32_t time_us;
+    EventLogId id;
+    int32_t a, b, c;
+};
+
+static EventRecord ring[EVENT_LOG_SIZE];
+static std::atomic<uint32_t> head{0};
+static uint32_t tail = 0;
+
+static constexpr uint32_t DRAIN_PERIOD_MS = 100;
+
+void event_log(EventLogId id, int32_t a, int32_t b, int32_t c) {
+    uint32_t index = head.fetch_add(1, std::memory_order_relaxed);
+    EventRecord& r = ring[index & (EVENT_LOG_SIZE - 1)];
+    r.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    r.time_us = (uint32_t)esp_timer_get_time();
+    r.id = id;
+    r.a = a;
+    r.b = b;
+    r.c = c;
+    r.seq.store(index + 1, std::memory_order_release);
+}
+
+static void print_record(const EventRecord& r) {
+    switch (r.id) {
+        case EVT_WS_BINARY:
+            ESP_LOGI(TAG, "[%lu] WS: seq: %ld, throttle: %ld, steering: %ld",
+                     (unsigned long)r.time_us, (long)r.a, (long)r.b, (long)r.c);
+            break;
+        case EVT_WS_JSON:
+            ESP_LOGI(TAG, "[%lu] WS: command: %ld, value: %ld", (unsigned long)r.time_us, (long)r.a, (long)r.b);
+            break;
+        case EVT_LIGHTS:
+            ESP_LOGI(TAG, "[%lu] Lights: flags: %ld, indicator: %ld, hazard: %ld",
+                     (unsigned long)r.time_us, (long)r.a, (long)r.b, (long)r.c);
+            break;
+        case EVT_HTTP_CONTROL:
+            ESP_LOGI(TAG, "[%lu] POST /control: fd: %ld, throttle: %ld, steering: %ld",
+                     (unsigned long)r.time_us, (long)r.a, (long)r.b, (long)r.c);
+            break;
+        case EVT_BOOT_REPORT:
+            boot_report_log();
+            break;
+        default:
+            break;
+    }
+}
+
+static void event_log_task(void *param) {
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(DRAIN_PERIOD_MS));
+
+        uint32_t end = head.load(std::memory_order_acquire);
+        if (end - tail > EVENT_LOG_SIZE) {
+            ESP_LOGW(TAG, "dropped %lu events", (unsigned long)(end - tail - EVENT_LOG_SIZE));
+            tail = end - EVENT_LOG_SIZE;
+        }
+
+        while (tail != end) {
+            const EventRecord& slot = ring[tail & (EVENT_LOG_SIZE - 1)];
+            if (slot.seq.load(std::memory_order_acquire) != tail + 1) break;  // still being written
+
+            EventRecord r;
+            r.time_us = slot.time_us;
+            r.id = slot.id;
+            r.a = slot.a;
+            r.b = slot.b;
+            r.c = slot.c;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // Overwritten by a producer that lapped us while copying
+            if (slot.seq.load(std::memory_order_relaxed) == tail + 1) {
+                print_record(r);
+            }
+            tail++;
+        }
+    }
+}
+
+void event_log_start() {
+    static TaskStorage<3072> storage;
+    task_spawn(event_log_task, "event_log", NULL, 1, storage);
+}
@@ -0,0 +1,43 @@
+#include "includes/freshness.hpp"
+
+void freshness_reset(FreshnessFilter* f) {
+    *f = {};
+    f->lag_ms = FRESHNESS_LAG_UNKNOWN;
+}
+
+FreshnessResult freshness_check(FreshnessFilter* f, const ControlCommand& cmd, uint32_t now_ms,
+                                uint32_t max_age_ms) {
+    // 16-bit sequence space, a frame is newer if it's less than half a wrap ahead
+    if (cmd.has_seq && f->have_seq && (int16_t)(cmd.seq - f->last_seq) <= 0) {
+        return FRESH_OLD_SEQ;
+    }
+
+    if (cmd.has_time) {
+        int32_t offset = (int32_t)(now_ms - cmd.client_ms);
+        if (!f->have_offset) {
+            f->min_offset[0] = f->min_offset[1] = offset;
+            f->window_start_ms = now_ms;
+            f->have_offset = true;
+        } else if (now_ms - f->window_start_ms >= FRESHNESS_WINDOW_MS) {
+            // Forget old minimums so clock drift or a route change can't pin
+            // the baseline forever
+            f->min_offset[1] = f->min_offset[0];
+            f->min_offset[0] = offset;
+            f->window_start_ms = now_ms;
+        } else if (offset - f->min_offset[0] < 0) {
+            f->min_offset[0] = offset;
+        }
+
+        int32_t base = f->min_offset[0] - f->min_offset[1] < 0 ? f->min_offset[0] : f->min_offset[1];
+        int32_t lag = offset - base;
+        if (lag < 0) lag = 0;
+        if ((uint32_t)lag > max_age_ms) return FRESH_TOO_LATE;
+        f->lag_ms = (uint16_t)(lag < FRESHNESS_LAG_UNKNOWN ? lag : FRESHNESS_LAG_UNKNOWN - 1);
+    }
+
+    if (cmd.has_seq) {
+        f->last_seq = cmd.seq;
+        f->have_seq = true;
+    }
+    return FRESH_OK;
+}
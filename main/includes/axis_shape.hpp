@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+#include "includes/command.hpp"
+
+// Per-axis input shaping, integer only (the C6 has no FPU).
+struct AxisShape {
+    int deadband;   // axis units around center that map to 0
+    int expo;       // 0 = linear, 100 = pure cubic
+};
+
+// Deadband with rescale (no jump at the edge), then expo blend.
+// Input and output are -CONTROL_AXIS_MAX..CONTROL_AXIS_MAX.
+static inline int axis_shape(int value, const AxisShape& shape) {
+    if (value > CONTROL_AXIS_MAX) value = CONTROL_AXIS_MAX;
+    if (value < -CONTROL_AXIS_MAX) value = -CONTROL_AXIS_MAX;
+
+    int mag = value < 0 ? -value : value;
+    if (mag <= shape.deadband) return 0;
+    mag = (int)((int64_t)(mag - shape.deadband) * CONTROL_AXIS_MAX / (CONTROL_AXIS_MAX - shape.deadband));
+
+    int64_t cubic = (int64_t)mag * mag / CONTROL_AXIS_MAX * mag / CONTROL_AXIS_MAX;
+    mag = (int)(((int64_t)(100 - shape.expo) * mag + shape.expo * cubic) / 100);
+
+    return value < 0 ? -mag : mag;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <stdint.h>
+#include "includes/metrics.hpp"
+#include "includes/power_limit.hpp"
+
+// Battery monitor (idf.py -DBATTERY_MONITOR=1 build). ADC1 samples the pack
+// voltage, through a divider, and the motor current, from a shunt amplifier,
+// in continuous mode; the DMA fills frames without the CPU and a low
+// priority task filters them (see power_limit.hpp) and publishes the latest
+// BatteryStatus. The control task only peeks that status once per tick, so
+// it never waits on the ADC.
+#define BATTERY_VBAT_GPIO       0
+#define BATTERY_CURRENT_GPIO    1
+// Both channels together, ~9 kHz each
+#define BATTERY_SAMPLE_HZ       18000
+#define BATTERY_FRAME_BYTES     1024
+#define BATTERY_POOL_BYTES      8192
+// adc_continuous_read() timeout, bounds how long a poll blocks
+#define BATTERY_POLL_MS         100
+// 100k / 100k divider: pack = 2 x pin
+#define BATTERY_DIVIDER_MUL     2
+// 50 mOhm shunt into a x20 amplifier
+#define BATTERY_CURRENT_MV_PER_A 1000
+
+struct BatteryStatus {
+    uint16_t vbat_mv;           // filtered pack voltage
+    int16_t current_ma;         // filtered motor current
+    PowerLevel level;
+    PowerLimit limit;
+};
+
+struct BatteryStats {
+    uint32_t frames;            // DMA frames read
+    uint32_t overruns;          // frames the driver dropped, the task fell behind
+    uint32_t level_changes;
+    uint16_t vbat_min_mv;       // lowest filtered voltage since boot
+    int16_t current_max_ma;
+};
+
+// Configure and start the ADC. Returns false if the pins or driver fail.
+bool battery_open();
+// Read and filter at most one DMA frame, waiting up to BATTERY_POLL_MS.
+// Returns false when nothing arrived.
+bool battery_poll();
+// battery_open plus a task that polls forever
+void battery_start();
+
+// Latest status, safe from any task. False until the first filtered sample.
+bool battery_status(BatteryStatus* out);
+BatteryStats battery_stats();
+void battery_format(metrics_emit_fn emit, void* ctx);
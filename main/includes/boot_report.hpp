@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include "includes/metrics.hpp"
+
+// Boot phase timestamps in esp_timer time, i.e. since the app image started
+// (ROM and second stage bootloader time comes before that and isn't
+// included). Each phase is stamped once, by whichever task reaches it first;
+// init runs on several tasks so phases may complete out of order.
+enum BootPhase : uint8_t {
+    BOOT_APP_MAIN,          // app_main entered
+    BOOT_NVS,               // NVS ready
+    BOOT_NETIF,             // TCP/IP stack and event loop up, httpd can start
+    BOOT_PERIPHERALS,       // lights, motor, servo ready
+    BOOT_HTTPD,             // control server listening
+    BOOT_AP_STARTED,        // soft-AP beaconing, stations can join
+    BOOT_ASSETS,            // SPIFFS mounted for the asset server
+    BOOT_FIRST_CLIENT,      // first station joined the AP
+    BOOT_FIRST_COMMAND,     // first command accepted
+    BOOT_PHASE_COUNT,
+};
+
+// Cheap once the phase is stamped: one relaxed load
+void boot_mark(BootPhase phase);
+
+// "app_main=12 nvs=40 ... first_command=-" in ms, - for phases not
+// reached yet. Logged from app_main after init and again, via the event
+// log, when the first command is accepted.
+void boot_report_log();
+void boot_format(metrics_emit_fn emit, void* ctx);
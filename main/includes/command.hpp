@@ -0,0 +1,82 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary control frame (little endian, 12 bytes):
+//   [0]     version
+//   [1]     flags (CONTROL_FLAG_*)
+//   [2..3]  sequence number, +1 per frame
+//   [4..5]  throttle, signed, -CONTROL_AXIS_MAX..CONTROL_AXIS_MAX
+//   [6..7]  steering, signed, -CONTROL_AXIS_MAX..CONTROL_AXIS_MAX
+//   [8..11] client timestamp, ms on any monotonic clock
+// Version 1 frames are the first 8 bytes and carry no timestamp.
+#define CONTROL_FRAME_VERSION 2
+#define CONTROL_FRAME_SIZE    12
+#define CONTROL_FRAME_V1_SIZE 8
+#define CONTROL_AXIS_MAX      32767
+
+// UDP control datagram: a version 2 control frame followed by a tag, the
+// first CONTROL_UDP_TAG_SIZE bytes (little endian) of SipHash-2-4 over the
+// frame under a shared 16-byte key. The tag keeps stray and forged packets
+// off the motor; it is not an encrypted channel.
+#define CONTROL_UDP_TAG_SIZE  4
+#define CONTROL_UDP_KEY_SIZE  16
+#define CONTROL_UDP_SIZE      (CONTROL_FRAME_SIZE + CONTROL_UDP_TAG_SIZE)
+
+#define CONTROL_FLAG_HEADLIGHTS (1 << 0)
+#define CONTROL_FLAG_HORN       (1 << 1)
+
+enum ControlCommandKind : uint8_t {
+    CMD_NONE,
+    CMD_FWD,
+    CMD_REV,
+    CMD_STOP,
+    CMD_LEFT,
+    CMD_RIGHT,
+    CMD_CENTER,
+    CMD_DRIVE,      // combined throttle + steering setpoint
+};
+
+struct ControlCommand {
+    ControlCommandKind kind;
+    uint8_t flags;
+    uint16_t seq;
+    int value;          // legacy fwd/rev speed
+    int16_t throttle;   // CMD_DRIVE only
+    int16_t steering;   // CMD_DRIVE only
+    bool has_seq;       // seq is meaningful (binary frames, rc_command with "seq")
+    bool has_time;      // client_ms is meaningful
+    uint32_t client_ms; // sender's clock when the command was made
+    uint32_t rx_us;     // esp_timer time the frame arrived, 0 if unknown
+    uint32_t parsed_us; // esp_timer time decoding finished
+};
+
+// Decode a binary control frame (either version). No allocation, no string
+// compares.
+bool command_decode_binary(const uint8_t* buf, size_t len, ControlCommand* out);
+size_t command_encode_binary(const ControlCommand& cmd, uint8_t* buf, size_t len);
+
+// UDP datagram with its tag. Decode fails on a bad length, version or tag.
+size_t command_encode_udp(const ControlCommand& cmd, const uint8_t* key, uint8_t* buf, size_t len);
+bool command_decode_udp(const uint8_t* buf, size_t len, const uint8_t* key, ControlCommand* out);
+
+// Fold any command into a CMD_DRIVE setpoint. Legacy commands only move the
+// axis they name, so "fwd" followed by "left" keeps both. Applied by the
+// control task, which keeps the newest command per axis within one tick.
+void command_merge(ControlCommand* setpoint, const ControlCommand& cmd);
+
+// A JSON "seq"/"ts" number as a wrapping counter. False, and the field is
+// ignored, for NaN, infinities, negatives and anything past 2^53 (no longer
+// an exact integer).
+bool command_counter_from_double(double v, uint64_t* out);
+
+// Decode a text frame: {"type":"rc_command","payload":{throttle,steering,...}}
+// with axes in [-1,1] and optional "seq"/"ts" as in the binary frame, or
+// legacy {"type":"control","command":"fwd","value":200}.
+bool command_decode_json(const char* buf, size_t len, ControlCommand* out);
+
+// Decode a bare setpoint object, the body of POST /control:
+// {"throttle":0.4,"steering":-1,"headlights":true,"horn":false}, optionally
+// with "seq"/"ts". Flat objects of numbers and booleans only; scanned in
+// place without allocating. Missing axes are 0.
+bool command_decode_setpoint(const char* buf, size_t len, ControlCommand* out);
@@ -0,0 +1,40 @@
+#pragma once
+#include <stdint.h>
+#include "includes/command.hpp"
+
+#define CONTROL_TASK_RATE_HZ  200
+#define CONTROL_TASK_PRIORITY 10
+
+// Snapshot of the last control tick, for telemetry
+struct ControlStatus {
+    uint16_t seq;           // last applied setpoint
+    uint8_t flags;
+    int16_t throttle;
+    int16_t steering;
+    int16_t motor;          // applied motor duty, scaled to +-CONTROL_AXIS_MAX
+    int16_t servo;          // applied (shaped) steering position
+    uint16_t loop_us;       // duration of the last control step
+};
+
+// Hand a decoded command to the control task. Safe from any task, never
+// blocks. The next tick merges the newest CMD_DRIVE setpoint and the newest
+// legacy throttle and steering commands, in the order they were published.
+void control_publish(const ControlCommand& cmd);
+
+// Replace the setpoint with a full CMD_DRIVE one, and leave a running
+// replay alone. For the replay engine.
+void control_replace(const ControlCommand& setpoint);
+
+// Run a control step now instead of at the next tick. Safe from any task.
+void control_kick();
+
+// One control tick: apply the newest setpoint if there is one, then advance
+// motor ramps. Called by control_task_run(); host builds call it directly.
+void control_step();
+
+// Latest ControlStatus, safe from any task. False before the first tick.
+bool control_status(ControlStatus* out);
+
+// Turn the calling task into the control task: raises its priority and
+// applies the latest setpoint at `rate_hz`. Owns gMotor/gServo. Never returns.
+void control_task_run(uint32_t rate_hz = CONTROL_TASK_RATE_HZ);
@@ -1,5 +1,8 @@
 #pragma once
 #include "esp_err.h"
+#include "includes/axis_shape.hpp"
+#include "includes/metrics.hpp"
+#include "includes/speed_pid.hpp"
 
 #ifdef __cplusplus
 extern "C" {
@@ -12,6 +15,29 @@ esp_err_t left();
 esp_err_t right();
 esp_err_t center();
 
+// Combined proportional setpoint, both axes -CONTROL_AXIS_MAX..CONTROL_AXIS_MAX.
+// Deadband and expo from controls_set_shape() are applied first.
+// flags are CONTROL_FLAG_* bits.
+esp_err_t drive(int throttle, int steering, uint8_t flags);
+
+// Per control-loop tick housekeeping (battery power limit, motor ramp
+// sequencing, speed loop)
+void controls_update();
+
+// Closed-loop throttle. With an encoder reader set, drive() takes the
+// throttle axis as a target speed (+-SPEED_MAX_MMPS at full scale) and
+// controls_update() runs the speed loop once per tick. `read_counts` returns
+// the running encoder count; nullptr goes back to open-loop duty.
+void controls_set_speed_loop(int32_t (*read_counts)(void), uint32_t counts_per_m, const SpeedGains* gains);
+// Target, slewed setpoint, measured speed and output, when the loop is on
+void controls_format(metrics_emit_fn emit, void* ctx);
+
+enum ControlAxis {
+    AXIS_THROTTLE,
+    AXIS_STEERING,
+};
+esp_err_t controls_set_shape(ControlAxis axis, AxisShape shape);
+
 #ifdef __cplusplus
 }
 #endif
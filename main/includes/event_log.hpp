@@ -0,0 +1,19 @@
+#pragma once
+#include <stdint.h>
+
+// Deferred binary log for per-frame events. Recording is a few stores into
+// a RAM ring; a low-priority task formats and prints the records later, so
+// UART output never sits in front of actuation. Oldest records are dropped
+// when the ring is full.
+#define EVENT_LOG_SIZE 64   // power of two
+
+enum EventLogId : uint16_t {
+    EVT_WS_BINARY,      // a = seq, b = throttle, c = steering
+    EVT_WS_JSON,        // a = command kind, b = value
+    EVT_LIGHTS,         // a = braking | reversing << 1 | headlights << 2, b = indicator, c = hazard
+    EVT_HTTP_CONTROL,   // a = fd, b = throttle, c = steering
+    EVT_BOOT_REPORT,    // first command accepted, prints the boot report
+};
+
+void event_log(EventLogId id, int32_t a = 0, int32_t b = 0, int32_t c = 0);
+void event_log_start();
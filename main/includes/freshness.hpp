@@ -0,0 +1,38 @@
+#pragma once
+#include <stdint.h>
+#include "includes/command.hpp"
+
+// Per-connection stale command filter. A command is dropped when its seq is
+// not newer than the last accepted one (late TCP retransmits, reordering),
+// or when it arrives more than max_age_ms later than the quickest recent
+// delivery.
+//
+// Client and car clocks are unrelated, so one-way lag is measured relative
+// to the smallest (arrival - client_ms) seen over the last two windows: that
+// minimum is the clock offset plus the best-case path delay, anything above
+// it is queueing on the way.
+#define CONTROL_MAX_AGE_MS      150
+#define FRESHNESS_WINDOW_MS     5000
+#define FRESHNESS_LAG_UNKNOWN   0xFFFF
+
+enum FreshnessResult {
+    FRESH_OK,
+    FRESH_OLD_SEQ,
+    FRESH_TOO_LATE,
+};
+
+struct FreshnessFilter {
+    bool have_seq;
+    uint16_t last_seq;
+    bool have_offset;
+    int32_t min_offset[2];      // current, previous window
+    uint32_t window_start_ms;
+    uint16_t lag_ms;            // of the last timestamped command, saturated
+};
+
+void freshness_reset(FreshnessFilter* f);
+
+// `now_ms` is the car's clock at arrival. Accepted commands advance the
+// filter, rejected ones leave last_seq alone.
+FreshnessResult freshness_check(FreshnessFilter* f, const ControlCommand& cmd, uint32_t now_ms,
+                                uint32_t max_age_ms = CONTROL_MAX_AGE_MS);
@@ -1,6 +1,8 @@
 #pragma once
 #include <stdint.h>
 
+#define LED_MAX_PIXELS 64
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -10,9 +12,23 @@ void led_status_set(uint8_t r, uint8_t g, uint8_t b);
 void led_status_blink(uint8_t r, uint8_t g, uint8_t b, int times, int delay_ms);
 
 void external_strip_init(int gpio_num, uint32_t max_leds);
-void create_amber_blink_task();
-void external_strip_set(uint8_t r[], uint8_t g[], uint8_t b[]);
-void external_strip_show();
+
+// Layered light state. The compositor task renders a frame only when this
+// changes or a blink keyframe is due.
+struct LightLayers {
+    bool headlights;
+    bool braking;
+    bool reversing;
+    int8_t indicator;   // -1 left, 0 off, 1 right
+    bool hazard;
+};
+void create_lights_task();
+void lights_set(const LightLayers* layers);
+void lights_get(LightLayers* layers);
+// Update some layers and keep the rest, atomically against other writers:
+// a lights_get()/lights_set() pair would write back a stale hazard
+void lights_set_hazard(bool on);
+void lights_set_drive(bool headlights, bool braking, bool reversing, int8_t indicator);
 
 enum VehicleLightState {
     NORMAL,
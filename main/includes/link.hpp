@@ -0,0 +1,44 @@
+#pragma once
+#include <stdint.h>
+#include "esp_http_server.h"
+#include "includes/metrics.hpp"
+
+// Link supervisor. WS pings carry the send time, their pongs give a smoothed
+// RTT and jitter per session (RFC 6298 style). The dead-man is a one-shot
+// esp_timer re-armed by every accepted command; when it fires the throttle
+// setpoint goes to zero, so the motor ramps down at its normal decel rate,
+// and the hazard lights come on until commands are back.
+//
+// Timeout = command period allowance + srtt + 4 * rttvar of the driver,
+// clamped to [DEADMAN_MIN_MS, DEADMAN_MAX_MS].
+#define LINK_PROBE_HZ           2
+#define DEADMAN_MIN_MS          250
+#define DEADMAN_MAX_MS          1000
+// Room for a few lost frames at the app's 20 Hz send rate
+#define DEADMAN_COMMAND_SLACK_MS 150
+
+enum LinkState : uint8_t {
+    LINK_IDLE,          // no driver yet, dead-man disarmed
+    LINK_OK,
+    LINK_LOST,          // dead-man fired, car stopped
+};
+
+struct LinkRtt {
+    bool valid;
+    uint16_t srtt_ms;
+    uint16_t rttvar_ms;
+};
+
+void link_rtt_sample(LinkRtt* rtt, uint32_t sample_ms);
+uint32_t link_deadman_timeout_ms(const LinkRtt& rtt);
+
+// Creates the dead-man and starts pinging WS sessions on `server`
+void link_start(httpd_handle_t server);
+// An accepted driver command arrived: re-arm the dead-man
+void link_command_accepted(const LinkRtt& rtt);
+LinkState link_state();
+
+// Pong payload from a probe, returns the RTT sample in ms or -1
+int32_t link_pong_rtt(const uint8_t* payload, size_t len, uint32_t now_ms);
+
+void link_format(metrics_emit_fn emit, void* ctx);
@@ -0,0 +1,79 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Latest-wins mailbox: any number of producers, one consumer, no locks.
+// Behaves like a single slot (only the newest value is ever read); the N
+// backing slots only exist so a producer never waits for the reader or for
+// another producer. Values published between two take() calls are coalesced.
+template <typename T, size_t N = 4>
+class LatestMailbox {
+public:
+    void publish(const T& value) {
+        uint32_t t = ticket_.fetch_add(1, std::memory_order_relaxed) + 1;
+        Slot& s = slots_[t % N];
+
+        // Seqlock per slot: odd while writing, 2 * ticket once complete
+        s.seq.store(2 * t - 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&s.value, &value, sizeof(T));
+        s.seq.store(2 * t, std::memory_order_release);
+
+        uint32_t cur = latest_.load(std::memory_order_relaxed);
+        while ((int32_t)(t - cur) > 0 &&
+               !latest_.compare_exchange_weak(cur, t, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Consumer only. Returns false if nothing newer than the last take() is
+    // available. `skipped` receives the number of values coalesced away.
+    bool take(T* out, uint32_t* skipped = nullptr) {
+        uint32_t t;
+        if (!read(out, &t) || t == taken_) return false;
+        if (skipped) *skipped = t - taken_ - 1;
+        taken_ = t;
+        return true;
+    }
+
+    // Newest value regardless of whether it was already taken
+    bool peek(T* out) const {
+        uint32_t t;
+        return read(out, &t);
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> seq{0};
+        T value;
+    };
+
+    // Bounded retries: a torn read means a newer value is being published,
+    // and spinning here could starve that (lower priority) producer.
+    bool read(T* out, uint32_t* ticket) const {
+        for (size_t attempt = 0; attempt < N; attempt++) {
+            uint32_t t = latest_.load(std::memory_order_acquire);
+            if (t == 0) return false;
+
+            const Slot& s = slots_[t % N];
+            uint32_t s1 = s.seq.load(std::memory_order_acquire);
+            if (s1 != 2 * t) continue;
+
+            T tmp;
+            memcpy(&tmp, &s.value, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq.load(std::memory_order_relaxed) != s1) continue;
+
+            *out = tmp;
+            *ticket = t;
+            return true;
+        }
+        return false;
+    }
+
+    Slot slots_[N];
+    std::atomic<uint32_t> ticket_{0};
+    std::atomic<uint32_t> latest_{0};   // ticket of newest complete slot, 0 = empty
+    uint32_t taken_ = 0;
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Always-on counters and fixed-bucket latency histograms. Recording is a
+// couple of relaxed atomic adds, no locks, no allocation.
+enum MetricCounter {
+    METRIC_FRAMES,
+    METRIC_PARSE_ERRORS,
+    METRIC_MALLOC_FAILURES,     // JSON arena exhausted (STATIC_ALLOCATION build)
+    METRIC_DROPPED_FRAMES,      // coalesced by the control mailbox
+    METRIC_STALE_FRAMES,        // older seq or too late, see freshness.hpp
+    METRIC_REJECTED_FRAMES,     // from spectators or over the session rate limit
+    METRIC_DEADMAN_STOPS,       // link lost, car stopped by the dead-man
+    METRIC_TELEMETRY_SKIPPED,   // client still busy with the previous frame
+    METRIC_HOT_PATH_ALLOCS,     // heap allocations while handling a command, see tasks.hpp
+    METRIC_COUNTER_COUNT,
+};
+
+// Stages of a command, all timestamps from esp_timer_get_time()
+enum MetricStage {
+    STAGE_PARSE,        // frame received -> decoded
+    STAGE_QUEUE,        // decoded -> picked up by the control task
+    STAGE_ACTUATE,      // picked up -> PWM registers written
+    STAGE_TOTAL,        // frame received -> PWM registers written
+    STAGE_COUNT,
+};
+
+// Bucket i counts latencies below (16 << i) us, the last one everything above
+#define METRIC_BUCKETS 14
+
+void metrics_count(MetricCounter counter, uint32_t n = 1);
+void metrics_latency(MetricStage stage, uint32_t us);
+
+// Text report, one "name value" or histogram line per call to `emit`
+typedef void (*metrics_emit_fn)(void* ctx, const char* line);
+void metrics_format(metrics_emit_fn emit, void* ctx);
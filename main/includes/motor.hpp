@@ -1,25 +1,70 @@
 #pragma once
 #include "driver/gpio.h"
 #include "driver/ledc.h"
+#include "esp_err.h"
 #include "esp_log.h"
+#include "includes/power_limit.hpp"
+#include "includes/pwm_profile.hpp"
+#include "includes/ramp.hpp"
+
+struct PwmProfile {
+    uint32_t         freq_hz;
+    uint32_t         resolution_bits;   // 0 = highest the clock allows at freq_hz
+    ledc_timer_t     timer;
+    ledc_channel_t   channel;
+};
+
+// Ultrasonic by default, no audible whine
+static constexpr PwmProfile MOTOR_PWM_DEFAULT = { 20000, 0, LEDC_TIMER_0, LEDC_CHANNEL_0 };
 
 class Motor {
     public:
-        Motor(gpio_num_t stby_pin, gpio_num_t bin1_pin, gpio_num_t bin2_pin, gpio_num_t pwm_pin);
+        Motor(gpio_num_t stby_pin, gpio_num_t bin1_pin, gpio_num_t bin2_pin, gpio_num_t pwm_pin,
+              const PwmProfile& profile = MOTOR_PWM_DEFAULT);
 
-        void init();
-        void forward(uint8_t speed);
-        void reverse(uint8_t speed);
+        esp_err_t init();
+        // speed 0..MOTOR_SPEED_MAX, scaled to the active duty resolution
+        void forward(uint16_t speed);
+        void reverse(uint16_t speed);
         void stop();
+        // Signed speed (+-MOTOR_SPEED_MAX) applied at once, no ramp. For the
+        // speed loop, which slews its own setpoint; stop() ramps as usual.
+        // Against the applied direction it only ramps down to 0.
+        void driveNow(int32_t speed);
+
+        void setRampLimits(const RampLimits& limits);
+        // Battery protection: caps |duty| and stretches acceleration on top
+        // of the ramp limits. A lower cap ramps the motor down at once, a
+        // higher one brings back the last requested speed. driveNow() only
+        // gets the duty cap, the speed loop slews its own setpoint.
+        void setPowerLimit(const PowerLimit& limit);
+        // Advances multi-segment ramps (brake-before-reverse). Call from the
+        // control task; the slews themselves run on the LEDC fade hardware.
+        void update();
+
+        uint32_t maxDuty() const { return max_duty_; }
+        // Duty currently on the pin (mid-fade included), negative in reverse
+        int32_t appliedDuty() const;
 
     private:
+        void setTarget(int32_t duty);
+        int32_t capDuty(int32_t duty) const;
+        void startSegment();
+        void setDirection(RampDir dir);
+
         gpio_num_t stby_pin_;
         gpio_num_t bin1_pin_;
         gpio_num_t bin2_pin_;
         gpio_num_t pwm_pin_;
+        PwmProfile profile_;
+        uint32_t max_duty_ = 0;
 
-        static constexpr ledc_timer_bit_t PWM_RES   = LEDC_TIMER_8_BIT;
-        static constexpr ledc_timer_t     PWM_TIMER = LEDC_TIMER_0;
-        static constexpr ledc_channel_t   PWM_CHANNEL = LEDC_CHANNEL_0;
-        static constexpr uint32_t         PWM_FREQ  = 1000;
+        RampLimits limits_ = { 300, 150, 20 };
+        RampPlan plan_ = {};
+        uint8_t segment_ = 0;
+        int64_t segment_end_us_ = 0;
+        int32_t target_ = 0;
+        int32_t request_ = 0;   // target before the power cap
+        PowerLimit power_ = POWER_LIMIT_NONE;
+        RampDir dir_ = RAMP_COAST;
 };
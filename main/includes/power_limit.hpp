@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+#include "includes/pwm_profile.hpp"
+
+// Battery protection, hardware-free so recorded sample streams can be run
+// through it on the host (host/battery_trace.cpp).
+//
+// Filtering: raw ADC samples are averaged in blocks of POWER_DECIMATION (a
+// boxcar decimator, one add per sample), then each block average goes
+// through a first-order IIR. At 9 kHz per channel a block is 10 ms, which
+// also spans whole periods of the 20 kHz motor PWM's 2 kHz alias.
+//
+// Levels follow the filtered pack voltage. Dropping a level is immediate;
+// climbing back needs POWER_HYSTERESIS_MV of headroom held for
+// POWER_RECOVER_MS, so the sag under a burst of throttle doesn't flip the
+// limit on and off. Cutoff is the exception: with the motor stopped the
+// pack rebounds well above POWER_CUTOFF_MV, so once reached it holds until
+// reboot or a charged cell (POWER_CHARGED_MV, again for POWER_RECOVER_MS).
+// Thresholds are for one LiPo cell under load.
+#define POWER_DECIMATION        90
+#define POWER_EMA_SHIFT         3       // ~8 block averages, ~80 ms
+#define POWER_LOW_MV            3500
+#define POWER_CRITICAL_MV       3300
+#define POWER_CUTOFF_MV         3100
+#define POWER_HYSTERESIS_MV     100
+#define POWER_RECOVER_MS        2000
+#define POWER_CHARGED_MV        3900
+
+enum PowerLevel : uint8_t {
+    POWER_OK,
+    POWER_LOW,          // duty and acceleration limited
+    POWER_CRITICAL,     // limited harder
+    POWER_CUTOFF,       // motor off, keep the radio alive
+    POWER_LEVEL_COUNT,
+};
+
+// What Motor may do at a level: |duty| up to max_speed (0..MOTOR_SPEED_MAX),
+// and 0 -> full duty no faster than min_accel_ms
+struct PowerLimit {
+    uint16_t max_speed;
+    uint32_t min_accel_ms;
+};
+
+static constexpr PowerLimit POWER_LIMIT_NONE = { MOTOR_SPEED_MAX, 0 };
+
+// Boxcar average over POWER_DECIMATION samples
+struct PowerDecimator {
+    uint32_t sum;
+    uint16_t count;
+};
+
+// Returns true when a block completes, its average in *out
+bool power_decimate(PowerDecimator* d, uint16_t raw, uint16_t* out);
+
+struct PowerEma {
+    int32_t value_q8;
+    bool primed;
+};
+
+// The first input primes the filter instead of rising from 0
+int32_t power_ema(PowerEma* f, int32_t x);
+
+struct PowerState {
+    PowerLevel level;
+    bool recovering;
+    uint32_t recover_since_ms;
+};
+
+PowerLevel power_level_for(int32_t vbat_mv);
+// Level after a new filtered voltage at `now_ms`
+PowerLevel power_level_update(PowerState* s, int32_t vbat_mv, uint32_t now_ms);
+PowerLimit power_limit_for(PowerLevel level);
+const char* power_level_name(PowerLevel level);
@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+
+// LEDC source with LEDC_AUTO_CLK: PLL_F80M on the C6, APB on the ESP32
+#define LEDC_SRC_CLK_HZ (80 * 1000 * 1000)
+
+// Normalized motor speed, scaled to whatever duty resolution is active
+#define MOTOR_SPEED_MAX 65535
+
+// Largest duty resolution the LEDC timer divider allows at freq_hz: one
+// period must hold 2^bits source clock cycles.
+static inline uint32_t pwm_max_resolution_bits(uint32_t src_clk_hz, uint32_t freq_hz, uint32_t hw_max_bits) {
+    if (freq_hz == 0) return 0;
+    uint32_t cycles = src_clk_hz / freq_hz;
+    uint32_t bits = 0;
+    while (bits < hw_max_bits && (cycles >> (bits + 1)) != 0) {
+        bits++;
+    }
+    return bits;
+}
+
+static inline uint32_t pwm_scale_speed(uint32_t speed, uint32_t max_duty) {
+    if (speed > MOTOR_SPEED_MAX) speed = MOTOR_SPEED_MAX;
+    return (uint32_t)(((uint64_t)speed * max_duty + MOTOR_SPEED_MAX / 2) / MOTOR_SPEED_MAX);
+}
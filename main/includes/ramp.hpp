@@ -0,0 +1,41 @@
+#pragma once
+#include <stdint.h>
+
+// Slew limits, expressed as the time for a full-scale change so they do not
+// depend on the PWM resolution.
+struct RampLimits {
+    uint32_t accel_ms;  // 0 -> max duty
+    uint32_t decel_ms;  // max duty -> 0
+    uint32_t brake_ms;  // short-brake hold before changing direction
+};
+
+enum RampDir : int8_t {
+    RAMP_REV = -1,
+    RAMP_COAST = 0,
+    RAMP_FWD = 1,
+    RAMP_BRAKE = 2,
+};
+
+// Linear duty change in one direction, or a brake hold (from == to == 0)
+struct RampSegment {
+    RampDir dir;
+    uint32_t from;
+    uint32_t to;
+    uint32_t duration_ms;
+};
+
+#define RAMP_MAX_SEGMENTS 3
+
+struct RampPlan {
+    RampSegment seg[RAMP_MAX_SEGMENTS];
+    uint8_t count;
+};
+
+// Plan a move between two signed duties (sign = direction). A sign change
+// becomes decel to 0, brake hold, accel in the new direction.
+RampPlan ramp_plan(int32_t current, int32_t target, uint32_t max_duty, const RampLimits& limits);
+
+// Signed duty `t_ms` after the plan started (brake reads as 0)
+int32_t ramp_sample(const RampPlan& plan, uint32_t t_ms);
+
+uint32_t ramp_duration_ms(const RampPlan& plan);
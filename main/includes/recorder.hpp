@@ -0,0 +1,70 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "includes/command.hpp"
+#include "includes/metrics.hpp"
+#include "includes/recording.hpp"
+
+// Command recorder and replay. The control task records every setpoint it
+// takes from the mailbox (decoded and merged, before controls.cpp) into a
+// RAM ring of RECORDER_RAM_BLOCKS blocks, ~7 bytes per setpoint; the oldest
+// block is overwritten when the ring is full. Format in recording.hpp.
+//
+// Flash: with a "recorder" data partition in the table, completed blocks can
+// also be copied there by a low-priority task (recorder_flash_enable). Block
+// sequence numbers continue across reboots, so the flash ring stays ordered.
+// A sector erase stalls code running from flash, the control task included,
+// so leave it off while driving for real.
+//
+// Replay: the RAM recording is fed back through the same control path, each
+// setpoint at its recorded offset from the first, timed by an esp_timer
+// one-shot and applied by an immediate control step. Recording pauses while
+// it runs. Any live command (or the dead-man) ends the replay and takes over;
+// a replay that runs to the end leaves the throttle at zero.
+#define RECORDER_RAM_BLOCKS     8
+#define RECORDER_PARTITION      "recorder"
+#define RECORDER_PARTITION_SUBTYPE 0x40
+#define RECORDER_FLUSH_MS       500
+
+struct RecorderStats {
+    uint32_t records;           // setpoints recorded since boot
+    uint32_t block_seq;         // block being filled
+    uint32_t flash_blocks;      // partition size in blocks, 0 = no partition
+    bool flash_enabled;
+    uint32_t flushed;           // blocks written to flash
+    uint32_t flush_dropped;     // overwritten in RAM before they were flushed
+    bool replaying;
+};
+
+// Finds the partition and starts the flush task. Recording works without it.
+void recorder_init();
+
+// Control task only: record the setpoint applied at `now_us`
+void recorder_record(const ControlCommand& setpoint, uint32_t now_us);
+
+// Copy RAM block `index` (0 = oldest, RECORDER_RAM_BLOCKS - 1 = the one
+// being filled) into `block`. False for a slot not filled yet or recycled
+// while copying.
+bool recorder_ram_read(uint32_t index, uint8_t* block);
+
+// Turn copying completed blocks to flash on or off. ESP_ERR_NOT_FOUND
+// without a partition.
+esp_err_t recorder_flash_enable(bool enable);
+// Same for the flash copy, 0 = oldest of its flash_blocks slots. False past
+// the end and for slots that hold no block of the current lap.
+bool recorder_flash_read(uint32_t index, uint8_t* block);
+
+// Replays the RAM recording. ESP_ERR_INVALID_STATE while a driver is live
+// (let the dead-man stop the car first) or already replaying,
+// ESP_ERR_NOT_FOUND when nothing is recorded.
+esp_err_t recorder_replay_start();
+void recorder_replay_stop();
+bool recorder_replaying();
+
+// Apply one recorded setpoint through the control mailbox. The replay timer
+// uses it; host builds call it, then control_step(), on their own clock.
+void recorder_apply(const RecordedSetpoint& r);
+
+RecorderStats recorder_stats();
+void recorder_format(metrics_emit_fn emit, void* ctx);
@@ -0,0 +1,64 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Command recording format. A recording is a sequence of fixed-size blocks,
+// each decodable on its own, so a RAM ring can drop its oldest block and a
+// flash copy can start anywhere without losing sync.
+//
+// Block (RECORDING_BLOCK_SIZE bytes, little endian):
+//   [0..3]   magic "EDR1"
+//   [4..7]   block sequence number, +1 per block
+//   [8..11]  esp_timer time of the first record, us (wraps after ~71 min)
+//   [12..13] bytes of records that follow
+//   [14..15] record count
+//   [16..]   records, rest of the block unused
+// Record:
+//   varint   us since the previous record in the block (0 for the first),
+//            7 bits per byte, low bits first, high bit = more
+//   [0]      flags (CONTROL_FLAG_*)
+//   [1..2]   throttle, signed
+//   [3..4]   steering, signed
+//   [5..6]   seq of the command that set it
+#define RECORDING_BLOCK_SIZE    1024
+#define RECORDING_HEADER_SIZE   16
+#define RECORDING_RECORD_MAX    12      // 5 byte varint + 7
+#define RECORDING_MAGIC         "EDR1"
+
+// One setpoint as the control task took it from the mailbox
+struct RecordedSetpoint {
+    uint32_t time_us;
+    uint8_t flags;
+    uint16_t seq;
+    int16_t throttle;
+    int16_t steering;
+};
+
+// Fills one block in place. The header's used/count only grow after the
+// record bytes are written, so a reader that copies the block sees whole
+// records.
+struct RecordingWriter {
+    uint8_t* block;
+    uint32_t last_us;
+};
+
+void recording_block_begin(RecordingWriter* w, uint8_t* block, uint32_t seq);
+// False when the block is full; begin a new one and append again
+bool recording_block_append(RecordingWriter* w, const RecordedSetpoint& r);
+
+// Header fields of a block, false if it is not one (erased flash, garbage)
+bool recording_block_check(const uint8_t* block, uint32_t* seq, uint16_t* count);
+
+// Walks the records of `count` blocks in order. Blocks that fail the check
+// are skipped; times are carried over from each block's start time.
+struct RecordingReader {
+    const uint8_t* const* blocks;
+    size_t count;
+    size_t index;
+    size_t offset;
+    uint16_t left;
+    uint32_t time_us;
+};
+
+void recording_reader_init(RecordingReader* r, const uint8_t* const* blocks, size_t count);
+bool recording_reader_next(RecordingReader* r, RecordedSetpoint* out);
@@ -0,0 +1,75 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "includes/command.hpp"
+#include "includes/control_task.hpp"
+#include "includes/metrics.hpp"
+
+// Scripted maneuvers. An uploaded list of keyframes, each a time offset
+// from the start and a setpoint, is applied from a chain of esp_timer
+// one-shots, every event timed from the start so timer latency never adds
+// up. With interpolation the axes move linearly from one keyframe to the
+// next, one setpoint per control period.
+//
+// Upload format, one keyframe per line, times non-decreasing:
+//   <t_ms> <setpoint object as for POST /control>
+//   0    {"throttle":0.5,"steering":0,"headlights":true}
+//   1500 {"throttle":0.5,"steering":-0.6}
+//   3000 {"throttle":0}
+// '#' lines are comments. The last keyframe ends the run and must have zero
+// throttle, so a finished run never leaves the car moving.
+//
+// A live command aborts the run (the command then applies as usual), and so
+// does the dead-man firing. Like a replay, a run only starts when no driver
+// is live. Drift: for each keyframe, the time the control step applied it
+// minus its scheduled time.
+#define SCHEDULE_MAX_KEYFRAMES  64
+#define SCHEDULE_LINE_MAX       96      // one keyframe line of an upload
+#define SCHEDULE_STEP_US        (1000000 / CONTROL_TASK_RATE_HZ)
+#define SCHEDULE_NO_DRIFT       INT32_MIN   // keyframe not applied (yet)
+
+struct Keyframe {
+    uint32_t t_ms;
+    uint8_t flags;
+    int16_t throttle;
+    int16_t steering;
+};
+
+enum ScheduleState : uint8_t {
+    SCHEDULE_EMPTY,
+    SCHEDULE_LOADED,
+    SCHEDULE_RUNNING,
+    SCHEDULE_DONE,
+    SCHEDULE_ABORTED,
+};
+
+enum ScheduleAbort : uint8_t {
+    SCHEDULE_ABORT_NONE,
+    SCHEDULE_ABORT_LIVE,        // a live command took over
+    SCHEDULE_ABORT_DEADMAN,
+    SCHEDULE_ABORT_STOPPED,     // POST /maneuver?stop=1
+};
+
+// One upload line. False for anything but "<t_ms> {...}".
+bool schedule_parse_keyframe(const char* line, size_t len, Keyframe* out);
+
+// Replace the loaded maneuver. ESP_ERR_INVALID_STATE while one runs,
+// ESP_ERR_INVALID_ARG for an empty list, times going back or a last
+// keyframe with throttle.
+esp_err_t scheduler_load(const Keyframe* frames, size_t count, bool interpolate);
+// ESP_ERR_NOT_FOUND with nothing loaded, ESP_ERR_INVALID_STATE while
+// running or while a driver is live
+esp_err_t scheduler_start();
+// Ends a running maneuver. Only SCHEDULE_ABORT_STOPPED zeroes the throttle
+// here, for the others the caller's own command follows.
+void scheduler_abort(ScheduleAbort reason);
+bool scheduler_running();
+
+// Control task: `setpoint` was just applied
+void scheduler_applied(const ControlCommand& setpoint);
+
+// State and drift summary for /metrics
+void scheduler_format(metrics_emit_fn emit, void* ctx);
+// Every keyframe with its drift, for GET /maneuver
+void scheduler_report(metrics_emit_fn emit, void* ctx);
@@ -1,17 +1,41 @@
 #pragma once
 #include <cstdint>
 #include "driver/ledc.h"
+#include "esp_err.h"
+#include "includes/servo_lut.hpp"
+
+struct ServoConfig {
+    uint32_t freq_hz;           // 50 for analog servos, up to 333 for digital ones
+    ServoCalibration cal;
+};
+
+// 30..150 degree throw on a 500-2500 us servo
+static constexpr ServoConfig SERVO_DEFAULT = { 50, { 833, 1500, 2167 } };
 
 class Servo {
 public:
-    Servo(int gpio_pin);
-    void init();
+    Servo(int gpio_pin, const ServoConfig& config = SERVO_DEFAULT);
+    // ESP_ERR_INVALID_ARG for a refresh rate of 0, calibration points out of
+    // order or a pulse longer than the frame
+    esp_err_t init();
+    // Signed position, -32767 full left .. 32767 full right, clamped. One
+    // table read.
+    inline void writePosition(int32_t position) {
+        ledc_set_duty(LEDC_LOW_SPEED_MODE, CHANNEL, lut_[servo_lut_index(position)]);
+        ledc_update_duty(LEDC_LOW_SPEED_MODE, CHANNEL);
+        position_ = servo_clamp_position(position);
+    }
+    // Last position written
+    int32_t position() const { return position_; }
+    void writeMicros(uint32_t us);
     void writeAngle(int angle); // 0-180
 private:
     int pin_;
+    ServoConfig config_;
+    uint32_t res_bits_ = 16;
+    int32_t position_ = 0;
+    uint16_t lut_[SERVO_LUT_SIZE] = {};
     static constexpr ledc_channel_t CHANNEL = LEDC_CHANNEL_1;
     static constexpr ledc_timer_t TIMER = LEDC_TIMER_1;
-    static constexpr uint32_t FREQ = 50;
-    static constexpr ledc_timer_bit_t RES = LEDC_TIMER_16_BIT;
     uint32_t angleToDutyUs(int angle);
 };
@@ -0,0 +1,44 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Position -> duty table, indexed by (position + 32768) >> SERVO_LUT_SHIFT
+// for a signed 16-bit position. Entry SERVO_LUT_CENTER is the trimmed center.
+#define SERVO_LUT_SHIFT  6
+#define SERVO_LUT_SIZE   (65536 >> SERVO_LUT_SHIFT)
+#define SERVO_LUT_CENTER (SERVO_LUT_SIZE / 2)
+
+// Calibrated pulse widths, center already includes trim
+struct ServoCalibration {
+    uint16_t min_us;      // full left
+    uint16_t center_us;
+    uint16_t max_us;      // full right
+};
+
+static inline uint32_t servo_us_to_duty(uint32_t us, uint32_t freq_hz, uint32_t res_bits) {
+    return (uint32_t)(((uint64_t)us * freq_hz * ((1u << res_bits) - 1)) / 1000000ULL);
+}
+
+static inline int32_t servo_clamp_position(int32_t position) {
+    return position < -32768 ? -32768 : (position > 32767 ? 32767 : position);
+}
+
+// Positions outside the signed 16-bit range read the end entries
+static inline size_t servo_lut_index(int32_t position) {
+    return (size_t)((servo_clamp_position(position) + 32768) >> SERVO_LUT_SHIFT);
+}
+
+// Piecewise linear through the three calibration points, so trim does not
+// change the endpoints.
+static inline void servo_build_lut(uint16_t* lut, const ServoCalibration& cal, uint32_t freq_hz, uint32_t res_bits) {
+    for (size_t i = 0; i < SERVO_LUT_SIZE; i++) {
+        uint32_t us;
+        if (i <= SERVO_LUT_CENTER) {
+            us = cal.min_us + (uint32_t)((cal.center_us - cal.min_us) * i / SERVO_LUT_CENTER);
+        } else {
+            size_t span = SERVO_LUT_SIZE - 1 - SERVO_LUT_CENTER;
+            us = cal.center_us + (uint32_t)((cal.max_us - cal.center_us) * (i - SERVO_LUT_CENTER) / span);
+        }
+        lut[i] = (uint16_t)servo_us_to_duty(us, freq_hz, res_bits);
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <atomic>
+#include <stdint.h>
+#include "esp_err.h"
+#include "includes/command.hpp"
+#include "includes/freshness.hpp"
+#include "includes/link.hpp"
+#include "includes/metrics.hpp"
+
+// Fixed-capacity table of httpd sessions keyed by socket fd. Sessions are
+// opened and closed from the httpd open/close callbacks; everything that
+// mutates a session runs on the httpd task. Other tasks only read the
+// atomics (role, ack).
+//
+// Arbitration: one driver at a time. The first session to send a valid
+// command becomes the driver; others are spectators whose commands are
+// dropped before the control path. A spectator takes over when the driver
+// has sent nothing accepted for SESSION_DRIVER_TIMEOUT_MS, or has gone.
+// The driver is a client, not a socket: another connection from the same
+// peer address (a browser's second keep-alive socket for POST /control)
+// drives at once if its own sequence filter accepts the frame. The driver's
+// filter comes along when the frame continues that sequence; a reloaded
+// page starts from seq 0 and keeps its own.
+#define SESSION_TABLE_SIZE          16      // power of two, > httpd max_open_sockets
+#define SESSION_DRIVER_TIMEOUT_MS   1000
+// Per-session command rate limit: sustained rate plus a burst allowance
+#define SESSION_RATE_HZ             60
+#define SESSION_RATE_BURST          10
+
+enum SessionRole : uint8_t {
+    ROLE_HTTP,          // plain HTTP, not upgraded to WS
+    ROLE_SPECTATOR,
+    ROLE_DRIVER,
+};
+
+enum SessionVerdict {
+    SESSION_ACCEPT,
+    SESSION_NOT_DRIVER,
+    SESSION_RATE_LIMITED,
+    SESSION_STALE,
+};
+
+struct SessionStats {
+    uint32_t frames;
+    uint32_t accepted;
+    uint32_t not_driver;
+    uint32_t rate_limited;
+    uint32_t stale;
+};
+
+struct Session {
+    int fd;                         // SESSION_FREE / SESSION_DELETED when unused
+    uint32_t peer_ip;               // IPv4, network order; 0 unknown (UDP listener)
+    std::atomic<uint8_t> role;
+    bool spectator_only;            // asked never to drive (/ws?role=spectator)
+    uint32_t opened_ms;
+    uint32_t last_seen_ms;          // any frame
+    uint32_t last_command_ms;       // last accepted command
+    uint32_t rate_tat_ms;           // rate limiter's theoretical arrival time
+    FreshnessFilter freshness;
+    std::atomic<uint32_t> ack;      // seq | lag_ms << 16
+    LinkRtt rtt;                    // from WS ping/pong
+    SessionStats stats;
+};
+
+// httpd open_fn / close_fn bodies. Open fails when the table is full.
+esp_err_t session_open(int fd, uint32_t now_ms);
+void session_close(int fd);
+
+// O(1) expected: hashed on fd with linear probing
+Session* session_get(int fd);
+
+// WebSocket handshake completed on the session
+void session_upgrade(Session* s, bool spectator_only);
+
+// Arbitration, rate limit and stale filtering for one decoded command.
+// Only SESSION_ACCEPT may be passed on to the control path.
+SessionVerdict session_admit(Session* s, const ControlCommand& cmd, uint32_t now_ms);
+
+// session_admit plus the rest of the receive path: metrics, and on accept
+// the command is stamped and published to the control task. `rx_time` is
+// esp_timer time at arrival. httpd task only.
+SessionVerdict session_submit(int fd, ControlCommand& cmd, int64_t rx_time);
+
+// WS pong received on the session
+void session_pong(Session* s, const uint8_t* payload, size_t len, uint32_t now_ms);
+
+// Cumulative ack and role for the session on `fd`, safe from any task
+bool session_ack(int fd, uint16_t* seq, uint16_t* lag_ms, SessionRole* role);
+
+// One line per open WS session, for /metrics. httpd task only.
+void session_format(metrics_emit_fn emit, void* ctx, uint32_t now_ms);
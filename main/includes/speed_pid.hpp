@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#include "includes/pwm_profile.hpp"
+
+// Closed-loop wheel speed, integer only (the C6 has no FPU). Speeds are
+// mm/s, the output is a signed Motor speed (+-MOTOR_SPEED_MAX).
+//
+//   out = ff * setpoint + kp * e + ki * integral(e dt) - kd * d(measured)/dt
+//
+// Feed-forward does most of the work at nominal voltage; the integral
+// picks up what battery sag, load and friction take away. The setpoint
+// slews toward the target at accel_mmps2, the closed-loop counterpart of
+// Motor's ramp limits. Output only ever pushes in the setpoint's direction:
+// slowing down is coasting, and a setpoint against the wheel's direction
+// gets no drive until the wheel is below SPEED_REVERSE_MMPS.
+#define SPEED_Q16(x)            ((int32_t)((x) * 65536.0))
+
+struct SpeedGains {
+    int32_t ff_q16;     // Motor speed units per mm/s
+    int32_t kp_q16;     // per mm/s of error
+    int32_t ki_q16;     // per mm/s*s of accumulated error
+    int32_t kd_q16;     // per mm/s^2, on the measurement (no setpoint kick)
+    int32_t accel_mmps2;
+};
+
+struct SpeedPid {
+    SpeedGains gains;
+    int32_t setpoint;           // slewed target
+    int64_t integral;           // error * us
+    int32_t prev_measured;
+    int32_t out;
+    int32_t out_max;            // MOTOR_SPEED_MAX unless power limited
+};
+
+// Throttle full scale in speed mode
+#define SPEED_MAX_MMPS          2500
+// Fastest the wheel may still turn the other way when the loop starts
+// driving it in the setpoint's direction
+#define SPEED_REVERSE_MMPS      100
+
+// Tuned on the host plant model (host/speed_sim.cpp): ~3 m/s no-load top
+// speed on a full pack, 150 ms mechanical time constant
+static constexpr SpeedGains SPEED_GAINS_DEFAULT = {
+    SPEED_Q16(65535.0 / 3000),  // full duty ~ top speed
+    SPEED_Q16(60),
+    SPEED_Q16(200),
+    0,
+    6000,
+};
+
+void speed_pid_init(SpeedPid* pid, const SpeedGains& gains);
+// One loop iteration `dt_us` after the previous one
+int32_t speed_pid_step(SpeedPid* pid, int32_t target_mmps, int32_t measured_mmps, uint32_t dt_us);
+
+// Wheel speed from an encoder count sampled once per control tick, over the
+// last SPEED_WINDOW_TICKS ticks: one count per tick alone is too coarse.
+#define SPEED_WINDOW_TICKS 4
+
+struct SpeedEstimate {
+    int32_t counts[SPEED_WINDOW_TICKS + 1];
+    uint32_t time_us[SPEED_WINDOW_TICKS + 1];
+    uint8_t head;
+    uint8_t filled;
+};
+
+int32_t speed_estimate(SpeedEstimate* e, int32_t counts, uint32_t now_us, uint32_t counts_per_m);
@@ -0,0 +1,53 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "includes/metrics.hpp"
+
+// Task creation for main/. Built with STATIC_ALLOCATION (idf.py
+// -DSTATIC_ALLOC=1) the TCB and stack live in the caller's TaskStorage in
+// .bss and the task is made with xTaskCreateStatic; otherwise both come
+// from the heap as before. Either way the task is registered for the stack
+// high-water report and per-task allocation counting.
+#define TASK_REGISTRY_SIZE 12
+
+template <size_t StackBytes>
+struct TaskStorage {
+#ifdef STATIC_ALLOCATION
+    StaticTask_t tcb;
+    StackType_t stack[StackBytes / sizeof(StackType_t)];
+#endif
+};
+
+// For tasks not made by task_spawn (app_main, httpd). Repeat calls are no-ops.
+void task_register(TaskHandle_t task);
+
+template <size_t StackBytes>
+TaskHandle_t task_spawn(TaskFunction_t fn, const char* name, void* param, UBaseType_t priority,
+                        TaskStorage<StackBytes>& storage) {
+#ifdef STATIC_ALLOCATION
+    TaskHandle_t task = xTaskCreateStatic(fn, name, StackBytes, param, priority, storage.stack, &storage.tcb);
+#else
+    TaskHandle_t task = nullptr;
+    if (xTaskCreate(fn, name, StackBytes, param, priority, &task) != pdPASS) task = nullptr;
+#endif
+    if (task) task_register(task);
+    return task;
+}
+
+// Unregister and delete the calling task
+void task_exit();
+
+// Heap allocations made so far by the calling task, counted by the heap
+// hooks (CONFIG_HEAP_USE_HOOKS) for registered tasks in the STATIC_ALLOCATION
+// build; always 0 otherwise. The hard zero-allocation check is the host's
+// bench_control_path, this is the on-device report.
+uint32_t task_alloc_count();
+
+// Steady-state check: allocations by the calling task since `mark` (a
+// task_alloc_count() value) are added to METRIC_HOT_PATH_ALLOCS
+void task_alloc_check(uint32_t mark);
+
+// One line per registered task: priority, least free stack seen, allocations
+void task_format(metrics_emit_fn emit, void* ctx);
@@ -0,0 +1,57 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_http_server.h"
+
+// Server -> client binary frame, broadcast to every WS session. Little-endian:
+//   0  type 'T'          1  light bits (TELEMETRY_LIGHT_*)
+//   2  seq u16           4  throttle i16      6  steering i16   (applied setpoint)
+//   8  motor i16         10 servo i16         (applied outputs, axis units)
+//   12 rssi i8 (this client, -128 unknown)    13 setpoint flags
+//   14 loop_us u16       16 heap_free u32     20 uptime_ms u32
+//   24 ack_seq u16       26 lag_ms u16        (this client's cumulative ack,
+//                                             lag 0xFFFF unknown)
+//   28 role u8 (SessionRole of this client)
+//   29 vbat_mv u16 (0 without the battery monitor)
+//   31 current_ma i16    33 power level u8 (PowerLevel)
+#define TELEMETRY_FRAME_TYPE  'T'
+#define TELEMETRY_FRAME_SIZE  34
+#define TELEMETRY_RATE_HZ     10
+#define TELEMETRY_RSSI_UNKNOWN (-128)
+// At least the httpd max_open_sockets
+#define TELEMETRY_MAX_CLIENTS 8
+
+#define TELEMETRY_LIGHT_HEADLIGHTS (1 << 0)
+#define TELEMETRY_LIGHT_BRAKING    (1 << 1)
+#define TELEMETRY_LIGHT_REVERSING  (1 << 2)
+#define TELEMETRY_LIGHT_HAZARD     (1 << 3)
+#define TELEMETRY_LIGHT_LEFT       (1 << 4)
+#define TELEMETRY_LIGHT_RIGHT      (1 << 5)
+
+struct TelemetryFrame {
+    uint8_t lights;
+    uint16_t seq;
+    int16_t throttle;
+    int16_t steering;
+    int16_t motor;
+    int16_t servo;
+    int8_t rssi;
+    uint8_t flags;
+    uint16_t loop_us;
+    uint32_t heap_free;
+    uint32_t uptime_ms;
+    uint16_t ack_seq;
+    uint16_t lag_ms;
+    uint8_t role;
+    uint16_t vbat_mv;
+    int16_t current_ma;
+    uint8_t power_level;
+};
+
+size_t telemetry_encode(const TelemetryFrame& frame, uint8_t* buf, size_t len);
+
+// One broadcast: snapshot the car state and queue a frame to every WS client
+// that isn't still busy with the previous one. telemetry_start() calls this
+// at `rate_hz` from its own task; host builds call it directly.
+void telemetry_broadcast(httpd_handle_t server);
+void telemetry_start(httpd_handle_t server, uint32_t rate_hz = TELEMETRY_RATE_HZ);
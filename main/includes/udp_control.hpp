@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include "esp_http_server.h"
+#include "includes/metrics.hpp"
+
+// Optional UDP control channel (idf.py -DUDP_CONTROL=1 build). Datagrams
+// carry the binary control frame plus a shared-key tag (CONTROL_UDP_SIZE).
+// Nothing is retransmitted: a lost packet is simply superseded by the next
+// one, so a bad radio moment never holds newer setpoints back the way a TCP
+// retransmit does. Out of order packets are dropped.
+//
+// The listener is one session (keyed by its socket) and goes through the
+// same arbitration, rate limit and stale filter as WS clients. Admission
+// runs on the httpd task via httpd_queue_work, which owns the session table;
+// if several packets land before it runs only the newest is applied.
+#define UDP_CONTROL_PORT        4210
+// Silence longer than this and the next packet starts a new sequence, so a
+// restarted client isn't dropped as out of order. Its timestamp must still
+// be later than the last packet taken: UDP clients stamp frames with a clock
+// that keeps running across their restarts (Unix time in ms, low 32 bits),
+// and a replayed capture is dropped. Until the first packet after a car
+// reboot there is nothing to compare against.
+#define UDP_CONTROL_RESYNC_MS   1000
+// recv() timeout, bounds how long a poll blocks
+#define UDP_CONTROL_POLL_MS     100
+
+struct UdpControlStats {
+    uint32_t packets;       // datagrams received
+    uint32_t bad_tag;       // wrong size, version or tag
+    uint32_t reordered;     // older than the newest seen, dropped
+    uint32_t lost;          // seq gaps (a late packet in a gap also counts as reordered)
+    uint32_t replayed;      // new sequence stamped no later than the last packet, dropped
+    uint32_t rejected;      // refused by the session (not driver, rate, stale)
+};
+
+// Bind the listener and queue its session's registration on the httpd task.
+// Returns false on socket errors.
+bool udp_control_open(httpd_handle_t server, uint16_t port, const uint8_t* key);
+// Receive and handle at most one datagram, waiting up to UDP_CONTROL_POLL_MS.
+// Returns false when nothing arrived.
+bool udp_control_poll();
+// udp_control_open plus a task that polls forever. The key comes from
+// CONFIG_ESPDRIVE_UDP_KEY (menuconfig, "ESPDrive"); without a 16-character
+// key UDP control does not start.
+void udp_control_start(httpd_handle_t server);
+
+UdpControlStats udp_control_stats();
+void udp_control_format(metrics_emit_fn emit, void* ctx);
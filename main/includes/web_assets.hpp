@@ -0,0 +1,20 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// One file of app/dist compiled into the app image (EMBED_WEB_ASSETS builds)
+struct WebAsset {
+    const char* path;       // "/index.html", "/assets/index-1a2b3c4d.js"
+    const uint8_t* data;    // flash-mapped rodata
+    uint32_t len;
+    const char* mime;
+    bool gzip;              // data is the .gz variant from build_frontend
+    const char* etag;       // strong, already quoted
+};
+
+// Generated by tools/gen_web_assets.py, sorted by path
+extern const WebAsset WEB_ASSETS[];
+extern const size_t WEB_ASSETS_COUNT;
+
+// Asset whose path is the first `len` chars of `path`, or NULL
+const WebAsset* web_asset_find(const char* path, size_t len);
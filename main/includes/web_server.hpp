@@ -1,5 +1,34 @@
 #pragma once
 
+// Two httpd instances so streaming the UI never queues a control frame:
+// control endpoints (/ws, /control, legacy GETs, /metrics) on their own port
+// and a higher priority task than the static asset server on port 80. Both
+// sit below the control task (CONTROL_TASK_PRIORITY). Client sockets of
+// both, 3 internal ones per httpd (listen + control pair) and everything
+// else in main/ must fit in CONFIG_LWIP_MAX_SOCKETS; web_server.cpp checks
+// the sum at compile time.
+#define CONTROL_HTTP_PORT       81
+#define CONTROL_HTTPD_PRIORITY  6
+#define CONTROL_HTTPD_STACK     4096
+#define CONTROL_HTTPD_SOCKETS   4       // driver, spectators, a POST client
+#define ASSET_HTTPD_PRIORITY    3
+#define ASSET_HTTPD_SOCKETS     6       // a browser's parallel connections
+#define HTTPD_INTERNAL_SOCKETS  3
+// UDP control listener plus one spare
+#define OTHER_SOCKETS           2
+#define SOCKET_BUDGET           (CONTROL_HTTPD_SOCKETS + ASSET_HTTPD_SOCKETS + 2 * HTTPD_INTERNAL_SOCKETS + OTHER_SOCKETS)
+
 #define WS_MAX_SIZE 1024
+// Send timeout on WebSocket sockets, which only carry small frames
+#define WS_SEND_TIMEOUT_MS 30
+// POST /control body, a bare setpoint object read onto the stack
+#define CONTROL_BODY_MAX 128
+
+// Static assets are streamed from SPIFFS in blocks of this size
+#define STATIC_CHUNK_SIZE 4096
+// "/spiffs" + SPIFFS object name (CONFIG_SPIFFS_OBJ_NAME_LEN) + ".gz"
+#define STATIC_PATH_MAX 64
+// Strong ETags are hashed from file contents once per path and remembered
+#define ETAG_CACHE_SIZE 32
 
 void start_webserver();
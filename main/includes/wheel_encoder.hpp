@@ -0,0 +1,20 @@
+#pragma once
+#include <stdint.h>
+#include "driver/gpio.h"
+#include "esp_err.h"
+
+// Quadrature wheel encoder on the PCNT peripheral, for the speed loop
+// (idf.py -DSPEED_CONTROL=1 build). Both edges of both channels count, so
+// the count runs at 4x the encoder's lines.
+//
+// Counts per metre of travel: encoder lines * 4 * gear ratio / wheel
+// circumference. 7200 is a 12 line motor encoder, 1:30 gearbox and 200 mm
+// wheels.
+#define WHEEL_ENCODER_COUNTS_PER_M  7200
+// Hardware counter range; the driver folds overflows into the running count
+#define WHEEL_ENCODER_PCNT_LIMIT    30000
+#define WHEEL_ENCODER_GLITCH_NS     1000
+
+esp_err_t wheel_encoder_init(gpio_num_t a_pin, gpio_num_t b_pin);
+// Running count since init, forward positive
+int32_t wheel_encoder_count();
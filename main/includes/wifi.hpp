@@ -1,4 +1,10 @@
 #pragma once
 #include <string>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
-void wifi_init_softap(const char* ssid, const char* pass);
+// Brings up NVS, the network stack and the soft-AP on a task of its own, so
+// the caller can initialize peripherals meanwhile. `ready` gets a task
+// notification as soon as the TCP/IP stack is up and servers can bind; the
+// AP itself keeps starting in the background (BOOT_AP_STARTED).
+void wifi_start_softap(const char* ssid, const char* pass, TaskHandle_t ready);
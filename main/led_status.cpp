@@ -1,33 +1,49 @@
 #include "includes/led_status.hpp"
+#include "includes/event_log.hpp"
+#include "includes/tasks.hpp"
 #include "led_strip.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "soc/soc_caps.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/semphr.h"
+#include <string.h>
 
 static const char* TAG = "LED_STATUS";
 
 static led_strip_handle_t led_strip = nullptr;
 static led_strip_handle_t ext_led_strip = nullptr;
-
-static TaskHandle_t amber_blink_task_handle = nullptr;
-static SemaphoreHandle_t amber_blink_mutex = nullptr;
-
-static bool amber_blink_active = false;
-static uint8_t base_r[4] = {0};
-static uint8_t base_g[4] = {0};
-static uint8_t base_b[4] = {0};
-
-static int amber_indices[2] = {0};
-static int amber_count = 0;
-
-static const uint32_t NUM_LEDS = 4;
-static const uint8_t amber_r_val = 255, amber_g_val = 133, amber_b_val = 3;
-
-// Forward declarations
-void external_strip_set(uint8_t r[], uint8_t g[], uint8_t b[], uint32_t num_leds);
-void external_strip_show();
-void set_base_led_colors(VehicleLightState state);
+static uint32_t num_leds = 0;
+
+static TaskHandle_t lights_task_handle = nullptr;
+static portMUX_TYPE layers_mux = portMUX_INITIALIZER_UNLOCKED;
+static LightLayers layers = { true, false, false, 0, false };
+static int64_t blink_start_us = 0;
+
+struct Pixel {
+    uint8_t r, g, b;
+};
+
+// Double-buffered frame: compose into the back buffer, push only on change
+static Pixel frames[2][LED_MAX_PIXELS];
+static int front = 0;
+
+static constexpr int64_t BLINK_HALF_PERIOD_US = 500 * 1000;
+
+static constexpr Pixel OFF = { 0, 0, 0 };
+static constexpr Pixel WHITE = { 255, 255, 255 };
+static constexpr Pixel RED_FULL = { 255, 0, 0 };
+static constexpr Pixel RED_HALF = { 128, 0, 0 };
+static constexpr Pixel AMBER = { 255, 133, 3 };
+
+// Strip zones in wiring order; longer strips are split evenly between them
+enum LightZone {
+    REAR_RIGHT,
+    REAR_LEFT,
+    FRONT_LEFT,
+    FRONT_RIGHT,
+    ZONE_COUNT,
+};
 
 void led_status_init(int gpio_num, uint32_t max_leds) {
     led_strip_config_t strip_config = {
@@ -67,6 +83,8 @@ void led_status_set(uint8_t r, uint8_t g, uint8_t b) {
 }
 
 void external_strip_init(int gpio_num, uint32_t max_leds) {
+    if (max_leds > LED_MAX_PIXELS) max_leds = LED_MAX_PIXELS;
+
     led_strip_config_t strip_config = {
         .strip_gpio_num = gpio_num,
         .max_leds = max_leds,
@@ -77,12 +95,18 @@ void external_strip_init(int gpio_num, uint32_t max_leds) {
         }
     };
 
+    // Long strips go out over DMA where the RMT supports it, so a refresh
+    // doesn't keep the CPU busy refilling the RMT memory block
+    bool with_dma = false;
+#if SOC_RMT_SUPPORT_DMA
+    with_dma = max_leds > 8;
+#endif
     led_strip_rmt_config_t rmt_config = {
         .clk_src = RMT_CLK_SRC_DEFAULT,
         .resolution_hz = 10 * 1000 * 1000,
-        .mem_block_symbols = 64,
+        .mem_block_symbols = with_dma ? 1024u : 64u,
         .flags = {
-            .with_dma = false
+            .with_dma = with_dma
         }
     };
 
@@ -93,149 +117,141 @@ void external_strip_init(int gpio_num, uint32_t max_leds) {
     }
 
     led_strip_clear(ext_led_strip);
+    num_leds = max_leds;
     ESP_LOGI(TAG, "External LED strip initialized on GPIO %d with %u LED(s)", gpio_num, (unsigned int)max_leds);
 }
 
-void external_strip_set(uint8_t r[], uint8_t g[], uint8_t b[], uint32_t num_leds) {
-    if (!ext_led_strip) return;
+static Pixel zone_color(LightZone zone, const LightLayers& l, bool blink_on) {
+    bool left_side = zone == REAR_LEFT || zone == FRONT_LEFT;
+    bool blinking = l.hazard || (l.indicator < 0 && left_side) || (l.indicator > 0 && !left_side);
+    if (blinking) {
+        return blink_on ? AMBER : OFF;
+    }
 
-    for (uint32_t i = 0; i < num_leds; i++) {
-        led_strip_set_pixel(ext_led_strip, i, r[i], g[i], b[i]);
+    if (zone == REAR_LEFT || zone == REAR_RIGHT) {
+        if (l.braking) return RED_FULL;
+        if (l.reversing) return WHITE;
+        return RED_HALF;
     }
+    return (l.headlights || l.reversing) ? WHITE : OFF;
 }
 
-void external_strip_show() {
+static void render(const LightLayers& l, bool blink_on) {
     if (!ext_led_strip) return;
+
+    Pixel* back = frames[front ^ 1];
+    for (uint32_t i = 0; i < num_leds; i++) {
+        back[i] = zone_color((LightZone)(i * ZONE_COUNT / num_leds), l, blink_on);
+    }
+    if (memcmp(back, frames[front], num_leds * sizeof(Pixel)) == 0) return;
+
+    for (uint32_t i = 0; i < num_leds; i++) {
+        led_strip_set_pixel(ext_led_strip, i, back[i].r, back[i].g, back[i].b);
+    }
     led_strip_refresh(ext_led_strip);
+    front ^= 1;
 }
 
-// Amber blinking task — runs forever
-static void amber_blink_task(void *param) {
-    while (true) {
-        bool blink_now = false;
+// Sleeps until notified by lights_set() or until the next blink keyframe
+static void lights_task(void *param) {
+    // Force the first render, frames[] starts out all black
+    memset(frames[front], 0xFF, sizeof(frames[front]));
 
-        // Take mutex and check if blinking is active
-        if (xSemaphoreTake(amber_blink_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-            blink_now = amber_blink_active;
-            xSemaphoreGive(amber_blink_mutex);
-        }
-
-        if (!blink_now) {
-            // If blinking not active, just show base colors and sleep a bit
-            external_strip_set(base_r, base_g, base_b, NUM_LEDS);
-            external_strip_show();
-            vTaskDelay(pdMS_TO_TICKS(100));
-            continue;
+    while (true) {
+        LightLayers l;
+        int64_t start;
+        taskENTER_CRITICAL(&layers_mux);
+        l = layers;
+        start = blink_start_us;
+        taskEXIT_CRITICAL(&layers_mux);
+
+        bool blink_on = true;
+        TickType_t wait = portMAX_DELAY;
+        if (l.hazard || l.indicator != 0) {
+            int64_t elapsed = esp_timer_get_time() - start;
+            blink_on = (elapsed / BLINK_HALF_PERIOD_US) % 2 == 0;
+            int64_t next_us = BLINK_HALF_PERIOD_US - elapsed % BLINK_HALF_PERIOD_US;
+            wait = pdMS_TO_TICKS(next_us / 1000) + 1;
         }
 
-        // Blink ON: set amber LEDs ON, others base color
-        for (int i = 0; i < amber_count; i++) {
-            int idx = amber_indices[i];
-            base_r[idx] = amber_r_val;
-            base_g[idx] = amber_g_val;
-            base_b[idx] = amber_b_val;
-        }
-        external_strip_set(base_r, base_g, base_b, NUM_LEDS);
-        external_strip_show();
-        vTaskDelay(pdMS_TO_TICKS(500));
-
-        // Blink OFF: set amber LEDs OFF, others base color
-        for (int i = 0; i < amber_count; i++) {
-            int idx = amber_indices[i];
-            base_r[idx] = 0;
-            base_g[idx] = 0;
-            base_b[idx] = 0;
-        }
-        external_strip_set(base_r, base_g, base_b, NUM_LEDS);
-        external_strip_show();
-        vTaskDelay(pdMS_TO_TICKS(500));
+        render(l, blink_on);
+        ulTaskNotifyTake(pdTRUE, wait);
     }
 }
 
-void create_amber_blink_task() {
-    amber_blink_mutex = xSemaphoreCreateMutex();
-    xTaskCreate(amber_blink_task, "amber_blink_task", 2048, NULL, 5, &amber_blink_task_handle);
+void create_lights_task() {
+    static TaskStorage<2048> storage;
+    lights_task_handle = task_spawn(lights_task, "lights_task", NULL, 2, storage);
 }
 
-void set_base_led_colors(VehicleLightState state) {
-    const uint8_t white_r = 255, white_g = 255, white_b = 255;
-    const uint8_t red_full = 255;
-    const uint8_t red_half = 128;
-
-    // Reset amber LEDs indices
-    amber_count = 0;
-
-    switch(state) {
-        case REVERSING:
-            for (int i = 0; i < NUM_LEDS; i++) {
-                base_r[i] = white_r;
-                base_g[i] = white_g;
-                base_b[i] = white_b;
-            }
-            break;
-
-        case BRAKING:
-            base_r[0] = red_full; base_g[0] = 0; base_b[0] = 0;
-            base_r[1] = red_full; base_g[1] = 0; base_b[1] = 0;
-            base_r[2] = white_r; base_g[2] = white_g; base_b[2] = white_b;
-            base_r[3] = white_r; base_g[3] = white_g; base_b[3] = white_b;
-            break;
-
-        case NORMAL:
-            base_r[0] = red_half; base_g[0] = 0; base_b[0] = 0;
-            base_r[1] = red_half; base_g[1] = 0; base_b[1] = 0;
-            base_r[2] = white_r; base_g[2] = white_g; base_b[2] = white_b;
-            base_r[3] = white_r; base_g[3] = white_g; base_b[3] = white_b;
-            break;
-
-        case STEERING_LEFT:
-            base_r[0] = red_half; base_g[0] = red_half; base_b[0] = red_half;
-            base_r[1] = 0; base_g[1] = 0; base_b[1] = 0; // amber LEDs off — blinking task controls these
-            base_r[2] = 0; base_g[2] = 0; base_b[2] = 0;
-            base_r[3] = white_r; base_g[3] = white_g; base_b[3] = white_b;
-
-            amber_indices[0] = 1;
-            amber_indices[1] = 2;
-            amber_count = 2;
-            break;
-
-        case STEERING_RIGHT:
-            base_r[0] = 0; base_g[0] = 0; base_b[0] = 0; // amber LEDs off — blinking task controls these
-            base_r[1] = red_half; base_g[1] = 0; base_b[1] = 0;
-            base_r[2] = white_r; base_g[2] = white_g; base_b[2] = white_b;
-            base_r[3] = 0; base_g[3] = 0; base_b[3] = 0;
-
-            amber_indices[0] = 0;
-            amber_indices[1] = 3;
-            amber_count = 2;
-            break;
-
-        default:
-            for (int i = 0; i < NUM_LEDS; i++) {
-                base_r[i] = 0;
-                base_g[i] = 0;
-                base_b[i] = 0;
-            }
-            break;
-    }
-
-    external_strip_set(base_r, base_g, base_b, NUM_LEDS);
-    external_strip_show();
+static bool same_layers(const LightLayers& a, const LightLayers& b) {
+    return a.headlights == b.headlights && a.braking == b.braking && a.reversing == b.reversing &&
+           a.indicator == b.indicator && a.hazard == b.hazard;
 }
 
-void set_vehicle_lights(VehicleLightState state) {
-    if (!amber_blink_mutex) {
-        ESP_LOGW(TAG, "amber_blink_mutex not initialized!");
-        return;
+// Caller holds layers_mux. False for a repeat of the current state.
+static bool apply_layers(const LightLayers& next) {
+    if (same_layers(layers, next)) return false;
+    bool was_blinking = layers.hazard || layers.indicator != 0;
+    bool blinking = next.hazard || next.indicator != 0;
+    // Restart the blink phase so a new indicator lights up immediately
+    if (blinking && (!was_blinking || next.indicator != layers.indicator || next.hazard != layers.hazard)) {
+        blink_start_us = esp_timer_get_time();
     }
+    layers = next;
+    return true;
+}
 
-    // Take mutex to update blinking flag and LED indices safely
-    if (xSemaphoreTake(amber_blink_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        amber_blink_active = (state == STEERING_LEFT || state == STEERING_RIGHT);
-        xSemaphoreGive(amber_blink_mutex);
+static void layers_changed(const LightLayers& now) {
+    if (lights_task_handle) {
+        xTaskNotifyGive(lights_task_handle);
     }
+    event_log(EVT_LIGHTS, now.braking | now.reversing << 1 | now.headlights << 2, now.indicator, now.hazard);
+}
 
-    set_base_led_colors(state);
+// Non-blocking: records the new state and wakes the compositor. Repeats of
+// the current state are dropped here, before any wakeup.
+void lights_set(const LightLayers* next) {
+    taskENTER_CRITICAL(&layers_mux);
+    bool changed = apply_layers(*next);
+    taskEXIT_CRITICAL(&layers_mux);
+    if (changed) layers_changed(*next);
+}
 
-    ESP_LOGI(TAG, "Set vehicle lights state %d", state);
+void lights_set_hazard(bool on) {
+    taskENTER_CRITICAL(&layers_mux);
+    LightLayers next = layers;
+    next.hazard = on;
+    bool changed = apply_layers(next);
+    taskEXIT_CRITICAL(&layers_mux);
+    if (changed) layers_changed(next);
+}
+
+void lights_set_drive(bool headlights, bool braking, bool reversing, int8_t indicator) {
+    taskENTER_CRITICAL(&layers_mux);
+    LightLayers next = layers;
+    next.headlights = headlights;
+    next.braking = braking;
+    next.reversing = reversing;
+    next.indicator = indicator;
+    bool changed = apply_layers(next);
+    taskEXIT_CRITICAL(&layers_mux);
+    if (changed) layers_changed(next);
+}
+
+void lights_get(LightLayers* out) {
+    taskENTER_CRITICAL(&layers_mux);
+    *out = layers;
+    taskEXIT_CRITICAL(&layers_mux);
+}
+
+void set_vehicle_lights(VehicleLightState state) {
+    taskENTER_CRITICAL(&layers_mux);
+    LightLayers next = layers;
+    next.braking = state == BRAKING;
+    next.reversing = state == REVERSING;
+    next.indicator = state == STEERING_LEFT ? -1 : (state == STEERING_RIGHT ? 1 : 0);
+    bool changed = apply_layers(next);
+    taskEXIT_CRITICAL(&layers_mux);
+    if (changed) layers_changed(next);
 }
@@ -0,0 +1,146 @@
+#include "includes/link.hpp"
+#include "includes/command.hpp"
+#include "includes/control_task.hpp"
+#include "includes/led_status.hpp"
+#include "includes/scheduler.hpp"
+#include "includes/session.hpp"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+static const char* TAG = "link";
+
+static httpd_handle_t link_server = nullptr;
+static esp_timer_handle_t deadman_timer = nullptr;
+static esp_timer_handle_t probe_timer = nullptr;
+static std::atomic<uint8_t> state{LINK_IDLE};
+static uint32_t armed_timeout_ms = 0;      // httpd task only
+static std::atomic<bool> probe_queued{false};
+
+static const char* const state_names[] = { "idle", "ok", "lost" };
+
+void link_rtt_sample(LinkRtt* rtt, uint32_t sample_ms) {
+    if (sample_ms > 0xFFFF) sample_ms = 0xFFFF;
+    if (!rtt->valid) {
+        rtt->srtt_ms = (uint16_t)sample_ms;
+        rtt->rttvar_ms = (uint16_t)(sample_ms / 2);
+        rtt->valid = true;
+        return;
+    }
+    int32_t err = (int32_t)sample_ms - rtt->srtt_ms;
+    uint32_t abs_err = err < 0 ? -err : err;
+    rtt->rttvar_ms = (uint16_t)((3 * rtt->rttvar_ms + abs_err) / 4);
+    rtt->srtt_ms = (uint16_t)((7 * rtt->srtt_ms + sample_ms) / 8);
+}
+
+uint32_t link_deadman_timeout_ms(const LinkRtt& rtt) {
+    uint32_t t = DEADMAN_COMMAND_SLACK_MS;
+    if (rtt.valid) t += rtt.srtt_ms + 4 * rtt.rttvar_ms;
+    if (t < DEADMAN_MIN_MS) t = DEADMAN_MIN_MS;
+    if (t > DEADMAN_MAX_MS) t = DEADMAN_MAX_MS;
+    return t;
+}
+
+// esp_timer task: nothing accepted from the driver for the whole timeout
+static void deadman_fired(void* arg) {
+    scheduler_abort(SCHEDULE_ABORT_DEADMAN);
+    ControlCommand stop = {};
+    stop.kind = CMD_STOP;
+    control_publish(stop);
+
+    state.store(LINK_LOST, std::memory_order_relaxed);
+    lights_set_hazard(true);
+    metrics_count(METRIC_DEADMAN_STOPS);
+    ESP_LOGW(TAG, "No commands for %u ms, stopping", (unsigned int)armed_timeout_ms);
+}
+
+void link_command_accepted(const LinkRtt& rtt) {
+    if (!deadman_timer) return;
+    uint32_t timeout_ms = link_deadman_timeout_ms(rtt);
+    // restart only works on a running timer, it may have just fired
+    if (state.load(std::memory_order_relaxed) != LINK_OK || timeout_ms != armed_timeout_ms ||
+        esp_timer_restart(deadman_timer, (uint64_t)timeout_ms * 1000) != ESP_OK) {
+        esp_timer_stop(deadman_timer);
+        esp_timer_start_once(deadman_timer, (uint64_t)timeout_ms * 1000);
+        armed_timeout_ms = timeout_ms;
+    }
+
+    if (state.exchange(LINK_OK, std::memory_order_relaxed) == LINK_LOST) {
+        lights_set_hazard(false);
+        ESP_LOGI(TAG, "Commands back");
+    }
+}
+
+LinkState link_state() {
+    return (LinkState)state.load(std::memory_order_relaxed);
+}
+
+static void write_u32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+int32_t link_pong_rtt(const uint8_t* payload, size_t len, uint32_t now_ms) {
+    if (len != 4) return -1;    // not one of ours (browsers echo the ping payload)
+    uint32_t sent_ms = (uint32_t)payload[0] | (uint32_t)payload[1] << 8 |
+                       (uint32_t)payload[2] << 16 | (uint32_t)payload[3] << 24;
+    uint32_t rtt = now_ms - sent_ms;
+    return rtt > 60000 ? -1 : (int32_t)rtt;
+}
+
+// httpd task, which owns the session table: one ping per WS session,
+// payload = send time in ms. httpd_ws_send_frame_async sends before it
+// returns, so the payload can live on the stack.
+static void probe_sessions(void* arg) {
+    probe_queued.store(false, std::memory_order_release);
+    int fds[SESSION_TABLE_SIZE];
+    size_t count = SESSION_TABLE_SIZE;
+    if (httpd_get_client_list(link_server, &count, fds) != ESP_OK) return;
+
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    uint8_t payload[4];
+    write_u32(payload, now_ms);
+    for (size_t i = 0; i < count; i++) {
+        if (httpd_ws_get_fd_info(link_server, fds[i]) != HTTPD_WS_CLIENT_WEBSOCKET) continue;
+        if (!session_get(fds[i])) continue;
+
+        httpd_ws_frame_t ping = {};
+        ping.final = true;
+        ping.type = HTTPD_WS_TYPE_PING;
+        ping.payload = payload;
+        ping.len = sizeof(payload);
+        httpd_ws_send_frame_async(link_server, fds[i], &ping);
+    }
+}
+
+// esp_timer task: hand the round over to httpd, at most one queued
+static void probe_tick(void* arg) {
+    if (!probe_queued.exchange(true, std::memory_order_acq_rel) &&
+        httpd_queue_work(link_server, probe_sessions, nullptr) != ESP_OK) {
+        probe_queued.store(false, std::memory_order_release);
+    }
+}
+
+void link_start(httpd_handle_t server) {
+    link_server = server;
+
+    esp_timer_create_args_t deadman_args = {};
+    deadman_args.callback = deadman_fired;
+    deadman_args.name = "deadman";
+    ESP_ERROR_CHECK(esp_timer_create(&deadman_args, &deadman_timer));
+
+    esp_timer_create_args_t probe_args = {};
+    probe_args.callback = probe_tick;
+    probe_args.name = "link_probe";
+    ESP_ERROR_CHECK(esp_timer_create(&probe_args, &probe_timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(probe_timer, 1000000 / LINK_PROBE_HZ));
+}
+
+void link_format(metrics_emit_fn emit, void* ctx) {
+    char line[64];
+    snprintf(line, sizeof(line), "link_state %s\n", state_names[link_state()]);
+    emit(ctx, line);
+    snprintf(line, sizeof(line), "deadman_timeout_ms %lu\n", (unsigned long)armed_timeout_ms);
+    emit(ctx, line);
+}
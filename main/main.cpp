@@ -1,12 +1,18 @@
+#include "includes/battery.hpp"
+#include "includes/boot_report.hpp"
 #include "includes/motor.hpp"
 #include "includes/servo.hpp"
 #include "includes/wifi.hpp"
 #include "includes/web_server.hpp"
 #include "includes/led_status.hpp"
+#include "includes/control_task.hpp"
+#include "includes/controls.hpp"
+#include "includes/event_log.hpp"
+#include "includes/recorder.hpp"
+#include "includes/wheel_encoder.hpp"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
-#include "esp_spiffs.h"
 #include <dirent.h>
 
 static constexpr int STBY_PIN = 19;
@@ -16,6 +22,8 @@ static constexpr int PWMB_PIN = 22;
 static constexpr int SERVO_PIN = 5;
 static constexpr int NEOPIXEL_PIN = 4;
 static constexpr int INBUILT_NEOPIXEL_PIN = 8;
+static constexpr int ENCODER_A_PIN = 2;
+static constexpr int ENCODER_B_PIN = 3;
 
 static const char* WIFI_SSID = "ESPDrive";
 static const char* WIFI_PASS = "12345678";
@@ -29,34 +37,43 @@ Servo gServo(static_cast<gpio_num_t>(SERVO_PIN));
 extern void start_webserver();
 
 extern "C" void app_main(void) {
+    boot_mark(BOOT_APP_MAIN);
     esp_log_level_set("*", ESP_LOG_INFO);
     ESP_LOGI(TAG, "Starting ESP Car");
 
-    // Mount SPIFFS
-    esp_vfs_spiffs_conf_t conf = {
-        .base_path = "/spiffs",
-        .partition_label = NULL,
-        .max_files = 5,
-        .format_if_mount_failed = true
-    };
-    esp_vfs_spiffs_register(&conf);
+    event_log_start();
+
+    // NVS, network stack and AP come up on their own task while the
+    // peripherals are initialized here
+    wifi_start_softap(WIFI_SSID, WIFI_PASS, xTaskGetCurrentTaskHandle());
 
     // Initialize external 4 LED strip
     external_strip_init(NEOPIXEL_PIN, 4);
-    create_amber_blink_task();
+    create_lights_task();
     set_vehicle_lights(NORMAL);
 
     // Initialize hardware
-    gMotor.init();
-    gServo.init();
-
-    // Start Wi-Fi
-    wifi_init_softap(WIFI_SSID, WIFI_PASS);
+    ESP_ERROR_CHECK(gMotor.init());
+    ESP_ERROR_CHECK(gServo.init());
+#ifdef SPEED_CONTROL_ENABLED
+    // Throttle becomes a speed target; without an encoder it stays duty
+    if (wheel_encoder_init(static_cast<gpio_num_t>(ENCODER_A_PIN), static_cast<gpio_num_t>(ENCODER_B_PIN)) == ESP_OK) {
+        controls_set_speed_loop(wheel_encoder_count, WHEEL_ENCODER_COUNTS_PER_M, nullptr);
+    }
+#endif
+#ifdef BATTERY_MONITOR_ENABLED
+    // Before the servers, so a flat pack is limited from the first command
+    battery_start();
+#endif
+    recorder_init();
+    boot_mark(BOOT_PERIPHERALS);
 
-    // Start web server
+    // Servers only need the TCP/IP stack, not a running AP. SPIFFS is
+    // mounted afterwards by the asset server, /ws doesn't wait for it.
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
     start_webserver();
+    boot_report_log();
 
-    while (true) {
-        vTaskDelay(pdMS_TO_TICKS(1000));
-    }
-}
\ No newline at end of file
+    // app_main becomes the control task, it owns gMotor/gServo from here on
+    control_task_run(CONTROL_TASK_RATE_HZ);
+}
@@ -0,0 +1,85 @@
+#include "includes/metrics.hpp"
+#include <atomic>
+#include <stdio.h>
+
+struct Histogram {
+    std::atomic<uint32_t> buckets[METRIC_BUCKETS];
+    std::atomic<uint32_t> count;
+    std::atomic<uint32_t> sum;      // wraps after ~71 minutes of accumulated latency
+    std::atomic<uint32_t> max;
+};
+
+static std::atomic<uint32_t> counters[METRIC_COUNTER_COUNT];
+static Histogram histograms[STAGE_COUNT];
+
+static const char* const counter_names[METRIC_COUNTER_COUNT] = {
+    "frames",
+    "parse_errors",
+    "malloc_failures",
+    "dropped_frames",
+    "stale_frames",
+    "rejected_frames",
+    "deadman_stops",
+    "telemetry_skipped",
+    "hot_path_allocs",
+};
+
+static const char* const stage_names[STAGE_COUNT] = {
+    "parse",
+    "queue",
+    "actuate",
+    "total",
+};
+
+static inline uint32_t bucket_index(uint32_t us) {
+    uint32_t bits = us ? 32 - __builtin_clz(us) : 0;
+    uint32_t idx = bits > 4 ? bits - 4 : 0;
+    return idx < METRIC_BUCKETS ? idx : METRIC_BUCKETS - 1;
+}
+
+void metrics_count(MetricCounter counter, uint32_t n) {
+    counters[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+void metrics_latency(MetricStage stage, uint32_t us) {
+    Histogram& h = histograms[stage];
+    h.buckets[bucket_index(us)].fetch_add(1, std::memory_order_relaxed);
+    h.count.fetch_add(1, std::memory_order_relaxed);
+    h.sum.fetch_add(us, std::memory_order_relaxed);
+
+    uint32_t prev = h.max.load(std::memory_order_relaxed);
+    while (us > prev && !h.max.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {
+    }
+}
+
+void metrics_format(metrics_emit_fn emit, void* ctx) {
+    char line[320];
+
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        snprintf(line, sizeof(line), "%s %lu\n", counter_names[i],
+                 (unsigned long)counters[i].load(std::memory_order_relaxed));
+        emit(ctx, line);
+    }
+
+    // latency_<stage>_us count=N sum=S max=M lt16=.. lt32=.. ... inf=..
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        const Histogram& h = histograms[s];
+        int n = snprintf(line, sizeof(line), "latency_%s_us count=%lu sum=%lu max=%lu", stage_names[s],
+                         (unsigned long)h.count.load(std::memory_order_relaxed),
+                         (unsigned long)h.sum.load(std::memory_order_relaxed),
+                         (unsigned long)h.max.load(std::memory_order_relaxed));
+        for (int b = 0; b < METRIC_BUCKETS && n < (int)sizeof(line); b++) {
+            unsigned long v = h.buckets[b].load(std::memory_order_relaxed);
+            if (b == METRIC_BUCKETS - 1) {
+                n += snprintf(line + n, sizeof(line) - n, " inf=%lu", v);
+            } else {
+                n += snprintf(line + n, sizeof(line) - n, " lt%lu=%lu", 16ul << b, v);
+            }
+        }
+        if (n < (int)sizeof(line) - 1) {
+            line[n++] = '\n';
+            line[n] = '\0';
+        }
+        emit(ctx, line);
+    }
+}
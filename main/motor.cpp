@@ -1,11 +1,24 @@
 #include "includes/motor.hpp"
+#include "esp_timer.h"
+#include "soc/soc_caps.h"
 
 static const char* TAG = "Motor";
 
-Motor::Motor(gpio_num_t stby_pin, gpio_num_t bin1_pin, gpio_num_t bin2_pin, gpio_num_t pwm_pin)
-    : stby_pin_(stby_pin), bin1_pin_(bin1_pin), bin2_pin_(bin2_pin), pwm_pin_(pwm_pin) {}
+Motor::Motor(gpio_num_t stby_pin, gpio_num_t bin1_pin, gpio_num_t bin2_pin, gpio_num_t pwm_pin,
+             const PwmProfile& profile)
+    : stby_pin_(stby_pin), bin1_pin_(bin1_pin), bin2_pin_(bin2_pin), pwm_pin_(pwm_pin), profile_(profile) {}
+
+esp_err_t Motor::init() {
+    // Check the frequency/resolution pair against the LEDC clock
+    uint32_t max_bits = pwm_max_resolution_bits(LEDC_SRC_CLK_HZ, profile_.freq_hz, SOC_LEDC_TIMER_BIT_WIDTH);
+    uint32_t bits = profile_.resolution_bits ? profile_.resolution_bits : max_bits;
+    if (bits == 0 || bits > max_bits) {
+        ESP_LOGE(TAG, "PWM %u Hz at %u bits exceeds LEDC clock (max %u bits)",
+                 (unsigned int)profile_.freq_hz, (unsigned int)bits, (unsigned int)max_bits);
+        return ESP_ERR_INVALID_ARG;
+    }
+    max_duty_ = (1u << bits) - 1;
 
-void Motor::init() {
     // Direction and standby pins
     gpio_reset_pin(stby_pin_);
     gpio_set_direction(stby_pin_, GPIO_MODE_OUTPUT);
@@ -19,47 +32,169 @@ void Motor::init() {
     // Configure PWM timer
     ledc_timer_config_t timer_cfg = {};
     timer_cfg.speed_mode       = LEDC_LOW_SPEED_MODE;
-    timer_cfg.duty_resolution  = PWM_RES;
-    timer_cfg.timer_num        = PWM_TIMER;
-    timer_cfg.freq_hz          = PWM_FREQ;
+    timer_cfg.duty_resolution  = (ledc_timer_bit_t)bits;
+    timer_cfg.timer_num        = profile_.timer;
+    timer_cfg.freq_hz          = profile_.freq_hz;
     timer_cfg.clk_cfg          = LEDC_AUTO_CLK;
-    ledc_timer_config(&timer_cfg);
+    esp_err_t err = ledc_timer_config(&timer_cfg);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "PWM timer config failed (err=%d)", err);
+        return err;
+    }
 
     // Configure PWM channel
     ledc_channel_config_t ch_cfg = {};
     ch_cfg.gpio_num   = pwm_pin_;
     ch_cfg.speed_mode = LEDC_LOW_SPEED_MODE;
-    ch_cfg.channel    = PWM_CHANNEL;
-    ch_cfg.timer_sel  = PWM_TIMER;
+    ch_cfg.channel    = profile_.channel;
+    ch_cfg.timer_sel  = profile_.timer;
     ch_cfg.duty       = 0;
     ch_cfg.hpoint     = 0;
     ledc_channel_config(&ch_cfg);
 
+    // Hardware fades for the ramps, no CPU involvement while slewing
+    ledc_fade_func_install(0);
+
     // Disable motor initially
     gpio_set_level(stby_pin_, 0);
 
-    ESP_LOGI(TAG, "Motor initialized (STBY=%d BIN1=%d BIN2=%d PWM=%d)",
-             stby_pin_, bin1_pin_, bin2_pin_, pwm_pin_);
+    ESP_LOGI(TAG, "Motor initialized (STBY=%d BIN1=%d BIN2=%d PWM=%d, %u Hz, %u bit)",
+             stby_pin_, bin1_pin_, bin2_pin_, pwm_pin_, (unsigned int)profile_.freq_hz, (unsigned int)bits);
+    return ESP_OK;
 }
 
-void Motor::forward(uint8_t speed) {
-    gpio_set_level(stby_pin_, 1);
-    gpio_set_level(bin1_pin_, 1);
-    gpio_set_level(bin2_pin_, 0);
-    ledc_set_duty(LEDC_LOW_SPEED_MODE, PWM_CHANNEL, speed);
-    ledc_update_duty(LEDC_LOW_SPEED_MODE, PWM_CHANNEL);
+void Motor::forward(uint16_t speed) {
+    setTarget((int32_t)pwm_scale_speed(speed, max_duty_));
 }
 
-void Motor::reverse(uint8_t speed) {
-    gpio_set_level(stby_pin_, 1);
-    gpio_set_level(bin1_pin_, 0);
-    gpio_set_level(bin2_pin_, 1);
-    ledc_set_duty(LEDC_LOW_SPEED_MODE, PWM_CHANNEL, speed);
-    ledc_update_duty(LEDC_LOW_SPEED_MODE, PWM_CHANNEL);
+void Motor::reverse(uint16_t speed) {
+    setTarget(-(int32_t)pwm_scale_speed(speed, max_duty_));
 }
 
 void Motor::stop() {
-    ledc_set_duty(LEDC_LOW_SPEED_MODE, PWM_CHANNEL, 0);
-    ledc_update_duty(LEDC_LOW_SPEED_MODE, PWM_CHANNEL);
-    gpio_set_level(stby_pin_, 0);
+    setTarget(0);
+}
+
+void Motor::driveNow(int32_t speed) {
+    uint32_t mag = pwm_scale_speed((uint32_t)(speed < 0 ? -speed : speed), max_duty_);
+    request_ = speed < 0 ? -(int32_t)mag : (int32_t)mag;
+    int32_t duty = capDuty(request_);
+    int32_t current = appliedDuty();
+    if ((duty > 0 && current < 0) || (duty < 0 && current > 0)) {
+        // Never flip the bridge under a driven motor: ramp down first, the
+        // next call starts the new direction from rest
+        setTarget(0);
+        return;
+    }
+    mag = (uint32_t)(duty < 0 ? -duty : duty);
+    bool ramping = segment_ < plan_.count;
+    if (duty == target_ && !ramping) return;
+    target_ = duty;
+    plan_.count = 0;
+    segment_ = 0;
+    if (ramping) ledc_fade_stop(LEDC_LOW_SPEED_MODE, profile_.channel);
+
+    if (duty == 0) {
+        setDirection(RAMP_COAST);
+        return;
+    }
+    setDirection(duty > 0 ? RAMP_FWD : RAMP_REV);
+    ledc_set_duty(LEDC_LOW_SPEED_MODE, profile_.channel, mag);
+    ledc_update_duty(LEDC_LOW_SPEED_MODE, profile_.channel);
+}
+
+void Motor::setRampLimits(const RampLimits& limits) {
+    limits_ = limits;
+}
+
+void Motor::setPowerLimit(const PowerLimit& limit) {
+    if (limit.max_speed == power_.max_speed && limit.min_accel_ms == power_.min_accel_ms) return;
+    power_ = limit;
+    setTarget(request_);
+}
+
+void Motor::update() {
+    if (segment_ >= plan_.count || esp_timer_get_time() < segment_end_us_) return;
+
+    if (++segment_ < plan_.count) {
+        startSegment();
+    } else if (target_ == 0) {
+        setDirection(RAMP_COAST);
+    }
+}
+
+int32_t Motor::appliedDuty() const {
+    if (dir_ != RAMP_FWD && dir_ != RAMP_REV) return 0;
+    int32_t duty = (int32_t)ledc_get_duty(LEDC_LOW_SPEED_MODE, profile_.channel);
+    return dir_ == RAMP_REV ? -duty : duty;
+}
+
+int32_t Motor::capDuty(int32_t duty) const {
+    int32_t cap = (int32_t)pwm_scale_speed(power_.max_speed, max_duty_);
+    return duty > cap ? cap : (duty < -cap ? -cap : duty);
+}
+
+void Motor::setTarget(int32_t duty) {
+    request_ = duty;
+    duty = capDuty(duty);
+    if (duty == target_) return;
+    target_ = duty;
+
+    // Replan from wherever the current fade has got to
+    ledc_fade_stop(LEDC_LOW_SPEED_MODE, profile_.channel);
+    int32_t current = appliedDuty();
+
+    RampLimits limits = limits_;
+    if (limits.accel_ms < power_.min_accel_ms) limits.accel_ms = power_.min_accel_ms;
+    plan_ = ramp_plan(current, duty, max_duty_, limits);
+    segment_ = 0;
+    if (plan_.count == 0) {
+        setDirection(RAMP_COAST);
+        return;
+    }
+    startSegment();
+}
+
+void Motor::startSegment() {
+    const RampSegment& seg = plan_.seg[segment_];
+    setDirection(seg.dir);
+
+    ledc_fade_stop(LEDC_LOW_SPEED_MODE, profile_.channel);
+    if (seg.dir == RAMP_BRAKE || seg.duration_ms == 0) {
+        ledc_set_duty(LEDC_LOW_SPEED_MODE, profile_.channel, seg.to);
+        ledc_update_duty(LEDC_LOW_SPEED_MODE, profile_.channel);
+    } else {
+        ledc_set_fade_with_time(LEDC_LOW_SPEED_MODE, profile_.channel, seg.to, seg.duration_ms);
+        ledc_fade_start(LEDC_LOW_SPEED_MODE, profile_.channel, LEDC_FADE_NO_WAIT);
+    }
+    segment_end_us_ = esp_timer_get_time() + (int64_t)seg.duration_ms * 1000;
+}
+
+void Motor::setDirection(RampDir dir) {
+    if (dir == dir_) return;
+    dir_ = dir;
+
+    switch (dir) {
+        case RAMP_FWD:
+            gpio_set_level(bin1_pin_, 1);
+            gpio_set_level(bin2_pin_, 0);
+            gpio_set_level(stby_pin_, 1);
+            break;
+        case RAMP_REV:
+            gpio_set_level(bin1_pin_, 0);
+            gpio_set_level(bin2_pin_, 1);
+            gpio_set_level(stby_pin_, 1);
+            break;
+        case RAMP_BRAKE:
+            // TB6612 short brake: both inputs high
+            gpio_set_level(bin1_pin_, 1);
+            gpio_set_level(bin2_pin_, 1);
+            gpio_set_level(stby_pin_, 1);
+            break;
+        default:
+            ledc_set_duty(LEDC_LOW_SPEED_MODE, profile_.channel, 0);
+            ledc_update_duty(LEDC_LOW_SPEED_MODE, profile_.channel);
+            gpio_set_level(stby_pin_, 0);
+            break;
+    }
 }
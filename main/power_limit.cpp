@@ -0,0 +1,67 @@
+#include "includes/power_limit.hpp"
+
+static const char* const level_names[] = { "ok", "low", "critical", "cutoff" };
+
+static const PowerLimit level_limits[] = {
+    POWER_LIMIT_NONE,
+    { MOTOR_SPEED_MAX * 70 / 100, 600 },
+    { MOTOR_SPEED_MAX * 40 / 100, 1200 },
+    { 0, 0 },
+};
+
+bool power_decimate(PowerDecimator* d, uint16_t raw, uint16_t* out) {
+    d->sum += raw;
+    if (++d->count < POWER_DECIMATION) return false;
+    *out = (uint16_t)((d->sum + POWER_DECIMATION / 2) / POWER_DECIMATION);
+    d->sum = 0;
+    d->count = 0;
+    return true;
+}
+
+int32_t power_ema(PowerEma* f, int32_t x) {
+    if (!f->primed) {
+        f->value_q8 = x * 256;
+        f->primed = true;
+    } else {
+        f->value_q8 += (x * 256 - f->value_q8) >> POWER_EMA_SHIFT;
+    }
+    return (f->value_q8 + 128) >> 8;
+}
+
+PowerLevel power_level_for(int32_t vbat_mv) {
+    if (vbat_mv < POWER_CUTOFF_MV) return POWER_CUTOFF;
+    if (vbat_mv < POWER_CRITICAL_MV) return POWER_CRITICAL;
+    if (vbat_mv < POWER_LOW_MV) return POWER_LOW;
+    return POWER_OK;
+}
+
+PowerLevel power_level_update(PowerState* s, int32_t vbat_mv, uint32_t now_ms) {
+    PowerLevel down = power_level_for(vbat_mv);
+    if (down > s->level) {
+        s->level = down;
+        s->recovering = false;
+        return s->level;
+    }
+
+    PowerLevel up = power_level_for(vbat_mv - POWER_HYSTERESIS_MV);
+    // Latched: only a charge clears a cutoff, not the rebound at rest
+    if (s->level == POWER_CUTOFF) up = vbat_mv >= POWER_CHARGED_MV ? POWER_OK : POWER_CUTOFF;
+    if (up >= s->level) {
+        s->recovering = false;
+    } else if (!s->recovering) {
+        s->recovering = true;
+        s->recover_since_ms = now_ms;
+    } else if (now_ms - s->recover_since_ms >= POWER_RECOVER_MS) {
+        s->level = up;
+        s->recovering = false;
+    }
+    return s->level;
+}
+
+PowerLimit power_limit_for(PowerLevel level) {
+    return level < POWER_LEVEL_COUNT ? level_limits[level] : POWER_LIMIT_NONE;
+}
+
+const char* power_level_name(PowerLevel level) {
+    return level < POWER_LEVEL_COUNT ? level_names[level] : "?";
+}
@@ -0,0 +1,66 @@
+#include "includes/ramp.hpp"
+
+static uint32_t scaled_ms(uint32_t delta, uint32_t max_duty, uint32_t full_scale_ms) {
+    if (max_duty == 0) return 0;
+    return (uint32_t)(((uint64_t)delta * full_scale_ms + max_duty - 1) / max_duty);
+}
+
+static void push(RampPlan* plan, RampDir dir, uint32_t from, uint32_t to, uint32_t duration_ms) {
+    plan->seg[plan->count++] = { dir, from, to, duration_ms };
+}
+
+RampPlan ramp_plan(int32_t current, int32_t target, uint32_t max_duty, const RampLimits& limits) {
+    RampPlan plan = {};
+
+    if (target > (int32_t)max_duty) target = (int32_t)max_duty;
+    if (target < -(int32_t)max_duty) target = -(int32_t)max_duty;
+
+    RampDir cur_dir = current > 0 ? RAMP_FWD : (current < 0 ? RAMP_REV : RAMP_COAST);
+    RampDir tgt_dir = target > 0 ? RAMP_FWD : (target < 0 ? RAMP_REV : RAMP_COAST);
+    uint32_t cur_mag = (uint32_t)(current < 0 ? -current : current);
+    uint32_t tgt_mag = (uint32_t)(target < 0 ? -target : target);
+
+    // Same direction (or starting from rest): one slew
+    if (cur_dir == RAMP_COAST || cur_dir == tgt_dir) {
+        if (tgt_dir == RAMP_COAST) return plan;
+        uint32_t full_ms = tgt_mag >= cur_mag ? limits.accel_ms : limits.decel_ms;
+        uint32_t delta = tgt_mag >= cur_mag ? tgt_mag - cur_mag : cur_mag - tgt_mag;
+        push(&plan, tgt_dir, cur_mag, tgt_mag, scaled_ms(delta, max_duty, full_ms));
+        return plan;
+    }
+
+    // Slowing to a stop, or reversing: decel first
+    push(&plan, cur_dir, cur_mag, 0, scaled_ms(cur_mag, max_duty, limits.decel_ms));
+    if (tgt_dir == RAMP_COAST) return plan;
+
+    push(&plan, RAMP_BRAKE, 0, 0, limits.brake_ms);
+    push(&plan, tgt_dir, 0, tgt_mag, scaled_ms(tgt_mag, max_duty, limits.accel_ms));
+    return plan;
+}
+
+int32_t ramp_sample(const RampPlan& plan, uint32_t t_ms) {
+    int32_t duty = 0;
+    for (uint8_t i = 0; i < plan.count; i++) {
+        const RampSegment& s = plan.seg[i];
+        if (s.dir == RAMP_BRAKE) {
+            duty = 0;
+        } else {
+            int64_t mag = s.to;
+            if (t_ms < s.duration_ms) {
+                mag = (int64_t)s.from + ((int64_t)s.to - (int64_t)s.from) * t_ms / s.duration_ms;
+            }
+            duty = (int32_t)(s.dir == RAMP_REV ? -mag : mag);
+        }
+        if (t_ms < s.duration_ms) return duty;
+        t_ms -= s.duration_ms;
+    }
+    return duty;
+}
+
+uint32_t ramp_duration_ms(const RampPlan& plan) {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < plan.count; i++) {
+        total += plan.seg[i].duration_ms;
+    }
+    return total;
+}
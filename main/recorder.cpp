@@ -0,0 +1,281 @@
+#include "includes/recorder.hpp"
+#include "includes/control_task.hpp"
+#include "includes/link.hpp"
+#include "includes/tasks.hpp"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+static const char* TAG = "recorder";
+
+static uint8_t ring[RECORDER_RAM_BLOCKS][RECORDING_BLOCK_SIZE];
+static RecordingWriter writer;                   // control task only
+static std::atomic<uint32_t> write_seq{0};      // block being filled
+static std::atomic<bool> started{false};        // writer has a block
+static std::atomic<uint32_t> stat_records{0};
+
+static const esp_partition_t* partition = nullptr;
+static uint32_t flash_blocks = 0;
+static std::atomic<bool> flash_enabled{false};
+static uint32_t flush_seq;                      // next block to flush, flush task only
+static bool flush_erased;                       // sector of flush_seq already erased
+static std::atomic<uint32_t> stat_flushed{0}, stat_flush_dropped{0};
+static uint8_t flush_buf[RECORDING_BLOCK_SIZE];
+
+static std::atomic<bool> replaying{false};
+static esp_timer_handle_t replay_timer = nullptr;
+static const uint8_t* replay_blocks[RECORDER_RAM_BLOCKS];
+static RecordingReader replay_reader;
+static RecordedSetpoint replay_next;
+static uint32_t replay_first_us;
+static int64_t replay_start_us;
+
+static uint8_t* ring_block(uint32_t seq) {
+    return ring[seq % RECORDER_RAM_BLOCKS];
+}
+
+void recorder_record(const ControlCommand& setpoint, uint32_t now_us) {
+    if (replaying.load(std::memory_order_relaxed)) return;
+
+    RecordedSetpoint r;
+    r.time_us = now_us;
+    r.flags = setpoint.flags;
+    r.seq = setpoint.seq;
+    r.throttle = setpoint.throttle;
+    r.steering = setpoint.steering;
+
+    if (!started.load(std::memory_order_relaxed)) {
+        recording_block_begin(&writer, ring_block(write_seq.load()), write_seq.load());
+        started.store(true, std::memory_order_release);
+    }
+    if (!recording_block_append(&writer, r)) {
+        uint32_t seq = write_seq.load(std::memory_order_relaxed) + 1;
+        write_seq.store(seq, std::memory_order_release);
+        recording_block_begin(&writer, ring_block(seq), seq);
+        recording_block_append(&writer, r);
+    }
+    stat_records.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Ring blocks oldest first, the one being filled last
+static size_t ram_blocks(const uint8_t** blocks) {
+    if (!started.load(std::memory_order_acquire)) return 0;
+    uint32_t last = write_seq.load(std::memory_order_acquire);
+    uint32_t first = last >= RECORDER_RAM_BLOCKS - 1 ? last - (RECORDER_RAM_BLOCKS - 1) : 0;
+    size_t n = 0;
+    for (uint32_t seq = first;; seq++) {
+        // Blocks from before a reboot (seq continued from flash) were never in RAM
+        uint32_t block_seq;
+        if (recording_block_check(ring_block(seq), &block_seq, nullptr) && block_seq == seq) {
+            blocks[n++] = ring_block(seq);
+        }
+        if (seq == last) break;
+    }
+    return n;
+}
+
+// Copy a block out of the ring; false if it was recycled meanwhile. The
+// header is copied before the records, so a block being filled comes out
+// with whole records only.
+static bool copy_block(uint32_t seq, uint8_t* out) {
+    memcpy(out, ring_block(seq), RECORDING_BLOCK_SIZE);
+    uint32_t copied, now;
+    return recording_block_check(out, &copied, nullptr) && copied == seq &&
+           recording_block_check(ring_block(seq), &now, nullptr) && now == seq;
+}
+
+bool recorder_ram_read(uint32_t index, uint8_t* block) {
+    if (!started.load(std::memory_order_acquire) || index >= RECORDER_RAM_BLOCKS) return false;
+    uint32_t last = write_seq.load(std::memory_order_acquire);
+    if (last < RECORDER_RAM_BLOCKS - 1 - index) return false;
+    return copy_block(last - (RECORDER_RAM_BLOCKS - 1) + index, block);
+}
+
+// --- flash -------------------------------------------------------------------
+
+static uint32_t flash_offset(uint32_t seq) {
+    return (seq % flash_blocks) * RECORDING_BLOCK_SIZE;
+}
+
+static void flush_block(uint32_t seq) {
+    if (!copy_block(seq, flush_buf)) {
+        stat_flush_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    uint32_t offset = flash_offset(seq);
+    uint32_t sector = offset - offset % partition->erase_size;
+    if (offset == sector || !flush_erased) {
+        // Entering a sector drops the oldest blocks it held
+        if (esp_partition_erase_range(partition, sector, partition->erase_size) != ESP_OK) return;
+    }
+    flush_erased = true;
+    if (esp_partition_write(partition, offset, flush_buf, RECORDING_BLOCK_SIZE) == ESP_OK) {
+        stat_flushed.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+static void flush_task(void* param) {
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(RECORDER_FLUSH_MS));
+        if (!flash_enabled.load(std::memory_order_acquire)) continue;
+
+        uint32_t filling = write_seq.load(std::memory_order_acquire);
+        if (filling - flush_seq > RECORDER_RAM_BLOCKS - 1) {
+            // Fell behind the ring, the missed blocks are gone
+            stat_flush_dropped.fetch_add(filling - flush_seq - (RECORDER_RAM_BLOCKS - 1), std::memory_order_relaxed);
+            flush_seq = filling - (RECORDER_RAM_BLOCKS - 1);
+        }
+        while (flush_seq != filling) flush_block(flush_seq++);
+    }
+}
+
+esp_err_t recorder_flash_enable(bool enable) {
+    if (!partition) return ESP_ERR_NOT_FOUND;
+    if (enable && !flash_enabled.load()) {
+        // Only blocks completed from now on; the flush task picks it up
+        flush_seq = write_seq.load(std::memory_order_acquire);
+        flush_erased = false;
+    }
+    flash_enabled.store(enable, std::memory_order_release);
+    ESP_LOGI(TAG, "Flash copy %s", enable ? "on" : "off");
+    return ESP_OK;
+}
+
+bool recorder_flash_read(uint32_t index, uint8_t* block) {
+    if (!partition || index >= flash_blocks) return false;
+    // Slot order from the one after the newest block; anything but the seq
+    // that belongs there is left over from an earlier lap or a gap
+    uint32_t next = write_seq.load(std::memory_order_acquire);
+    if (next + index < flash_blocks) return false;
+    uint32_t seq = next + index - flash_blocks;
+    uint32_t block_seq;
+    return esp_partition_read(partition, flash_offset(seq), block, RECORDING_BLOCK_SIZE) == ESP_OK &&
+           recording_block_check(block, &block_seq, nullptr) && block_seq == seq;
+}
+
+void recorder_init() {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                         (esp_partition_subtype_t)RECORDER_PARTITION_SUBTYPE, RECORDER_PARTITION);
+    if (partition) {
+        flash_blocks = partition->size / RECORDING_BLOCK_SIZE;
+        // Continue after the newest block on flash so its ring stays in order
+        uint32_t next = 0;
+        uint8_t header[RECORDING_HEADER_SIZE];
+        for (uint32_t slot = 0; slot < flash_blocks; slot++) {
+            uint32_t seq;
+            if (esp_partition_read(partition, slot * RECORDING_BLOCK_SIZE, header, sizeof(header)) == ESP_OK &&
+                recording_block_check(header, &seq, nullptr) && seq + 1 > next) {
+                next = seq + 1;
+            }
+        }
+        write_seq.store(next);
+        ESP_LOGI(TAG, "Flash partition: %lu blocks, next block %lu", (unsigned long)flash_blocks,
+                 (unsigned long)next);
+
+        static TaskStorage<3072> storage;
+        task_spawn(flush_task, "recorder_flush", NULL, 1, storage);
+    } else {
+        ESP_LOGI(TAG, "No \"%s\" partition, recording to RAM only", RECORDER_PARTITION);
+    }
+}
+
+// --- replay ------------------------------------------------------------------
+
+void recorder_apply(const RecordedSetpoint& r) {
+    ControlCommand setpoint = {};
+    setpoint.kind = CMD_DRIVE;
+    setpoint.flags = r.flags;
+    setpoint.seq = r.seq;
+    setpoint.throttle = r.throttle;
+    setpoint.steering = r.steering;
+    control_replace(setpoint);
+}
+
+static void replay_finish() {
+    esp_timer_stop(replay_timer);
+    ControlCommand stop = {};
+    stop.kind = CMD_STOP;
+    control_publish(stop);
+}
+
+// esp_timer task: apply the due setpoint, then arm for the next one
+static void replay_fire(void* arg) {
+    if (!replaying.load(std::memory_order_acquire)) return;
+    recorder_apply(replay_next);
+    control_kick();
+    // A stop that raced with the apply above must still win
+    if (!replaying.load(std::memory_order_acquire)) {
+        replay_finish();
+        return;
+    }
+
+    if (!recording_reader_next(&replay_reader, &replay_next)) {
+        ESP_LOGI(TAG, "Replay finished");
+        recorder_replay_stop();
+        return;
+    }
+    // Offsets from the start, so timer latency never accumulates
+    int64_t due = replay_start_us + (replay_next.time_us - replay_first_us);
+    int64_t wait = due - esp_timer_get_time();
+    esp_timer_start_once(replay_timer, wait > 0 ? (uint64_t)wait : 0);
+}
+
+esp_err_t recorder_replay_start() {
+    if (replaying.load() || link_state() == LINK_OK) return ESP_ERR_INVALID_STATE;
+    if (!replay_timer) {
+        esp_timer_create_args_t args = {};
+        args.callback = replay_fire;
+        args.name = "replay";
+        ESP_ERROR_CHECK(esp_timer_create(&args, &replay_timer));
+    }
+
+    // Pause recording first, so the ring holds still while it is read
+    replaying.store(true, std::memory_order_release);
+    size_t count = ram_blocks(replay_blocks);
+    recording_reader_init(&replay_reader, replay_blocks, count);
+    if (!recording_reader_next(&replay_reader, &replay_next)) {
+        replaying.store(false, std::memory_order_release);
+        return ESP_ERR_NOT_FOUND;
+    }
+    replay_first_us = replay_next.time_us;
+    replay_start_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "Replaying %u blocks", (unsigned int)count);
+    return esp_timer_start_once(replay_timer, 0);
+}
+
+void recorder_replay_stop() {
+    if (!replaying.exchange(false, std::memory_order_acq_rel)) return;
+    replay_finish();
+}
+
+bool recorder_replaying() {
+    return replaying.load(std::memory_order_acquire);
+}
+
+RecorderStats recorder_stats() {
+    RecorderStats s;
+    s.records = stat_records.load(std::memory_order_relaxed);
+    s.block_seq = write_seq.load(std::memory_order_relaxed);
+    s.flash_blocks = flash_blocks;
+    s.flash_enabled = flash_enabled.load(std::memory_order_relaxed);
+    s.flushed = stat_flushed.load(std::memory_order_relaxed);
+    s.flush_dropped = stat_flush_dropped.load(std::memory_order_relaxed);
+    s.replaying = replaying.load(std::memory_order_relaxed);
+    return s;
+}
+
+void recorder_format(metrics_emit_fn emit, void* ctx) {
+    RecorderStats s = recorder_stats();
+    char line[160];
+    snprintf(line, sizeof(line),
+             "recorder records=%lu block=%lu flash_blocks=%lu flash=%s flushed=%lu flush_dropped=%lu replay=%s\n",
+             (unsigned long)s.records, (unsigned long)s.block_seq, (unsigned long)s.flash_blocks,
+             s.flash_enabled ? "on" : "off", (unsigned long)s.flushed, (unsigned long)s.flush_dropped,
+             s.replaying ? "on" : "off");
+    emit(ctx, line);
+}
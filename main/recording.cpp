@@ -0,0 +1,116 @@
+#include "includes/recording.hpp"
+#include <atomic>
+#include <string.h>
+
+static inline uint16_t read_u16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline void write_u16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline uint32_t read_u32(const uint8_t* p) {
+    return (uint32_t)read_u16(p) | ((uint32_t)read_u16(p + 2) << 16);
+}
+
+static inline void write_u32(uint8_t* p, uint32_t v) {
+    write_u16(p, (uint16_t)(v & 0xFFFF));
+    write_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+void recording_block_begin(RecordingWriter* w, uint8_t* block, uint32_t seq) {
+    w->block = block;
+    w->last_us = 0;
+    memcpy(block, RECORDING_MAGIC, 4);
+    write_u32(block + 4, seq);
+    write_u32(block + 8, 0);
+    write_u16(block + 12, 0);
+    write_u16(block + 14, 0);
+}
+
+bool recording_block_append(RecordingWriter* w, const RecordedSetpoint& r) {
+    uint8_t* block = w->block;
+    uint16_t used = read_u16(block + 12);
+    uint16_t count = read_u16(block + 14);
+    if (RECORDING_HEADER_SIZE + used + RECORDING_RECORD_MAX > RECORDING_BLOCK_SIZE) return false;
+
+    if (count == 0) {
+        write_u32(block + 8, r.time_us);
+        w->last_us = r.time_us;
+    }
+    uint8_t* p = block + RECORDING_HEADER_SIZE + used;
+    uint32_t delta = r.time_us - w->last_us;
+    while (delta >= 0x80) {
+        *p++ = (uint8_t)(delta | 0x80);
+        delta >>= 7;
+    }
+    *p++ = (uint8_t)delta;
+    *p++ = r.flags;
+    write_u16(p, (uint16_t)r.throttle);
+    write_u16(p + 2, (uint16_t)r.steering);
+    write_u16(p + 4, r.seq);
+    p += 6;
+    w->last_us = r.time_us;
+
+    // Records first, then the header that makes them visible
+    std::atomic_thread_fence(std::memory_order_release);
+    write_u16(block + 12, (uint16_t)(p - block - RECORDING_HEADER_SIZE));
+    write_u16(block + 14, (uint16_t)(count + 1));
+    return true;
+}
+
+bool recording_block_check(const uint8_t* block, uint32_t* seq, uint16_t* count) {
+    if (memcmp(block, RECORDING_MAGIC, 4) != 0) return false;
+    if (RECORDING_HEADER_SIZE + read_u16(block + 12) > RECORDING_BLOCK_SIZE) return false;
+    if (seq) *seq = read_u32(block + 4);
+    if (count) *count = read_u16(block + 14);
+    return true;
+}
+
+void recording_reader_init(RecordingReader* r, const uint8_t* const* blocks, size_t count) {
+    r->blocks = blocks;
+    r->count = count;
+    r->index = 0;
+    r->offset = 0;
+    r->left = 0;
+    r->time_us = 0;
+}
+
+bool recording_reader_next(RecordingReader* r, RecordedSetpoint* out) {
+    while (r->left == 0) {
+        if (r->index >= r->count) return false;
+        const uint8_t* block = r->blocks[r->index++];
+        uint16_t count;
+        if (!recording_block_check(block, nullptr, &count) || count == 0) continue;
+        r->left = count;
+        r->offset = RECORDING_HEADER_SIZE;
+        r->time_us = read_u32(block + 8);
+    }
+
+    const uint8_t* block = r->blocks[r->index - 1];
+    const uint8_t* end = block + RECORDING_HEADER_SIZE + read_u16(block + 12);
+    const uint8_t* p = block + r->offset;
+    uint32_t delta = 0;
+    for (int shift = 0; p < end && shift < 35; shift += 7) {
+        uint8_t b = *p++;
+        delta |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+    }
+    if (end - p < 7) {
+        // Truncated block, skip the rest of it
+        r->left = 0;
+        return recording_reader_next(r, out);
+    }
+
+    r->time_us += delta;
+    out->time_us = r->time_us;
+    out->flags = p[0];
+    out->throttle = (int16_t)read_u16(p + 1);
+    out->steering = (int16_t)read_u16(p + 3);
+    out->seq = read_u16(p + 5);
+    r->offset = (size_t)(p + 7 - block);
+    r->left--;
+    return true;
+}
@@ -0,0 +1,213 @@
+#include "includes/scheduler.hpp"
+#include "includes/link.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* TAG = "scheduler";
+
+static Keyframe frames[SCHEDULE_MAX_KEYFRAMES];
+static int32_t drift_us[SCHEDULE_MAX_KEYFRAMES];
+static size_t frame_count = 0;
+static bool interpolate = false;
+static std::atomic<uint8_t> state{SCHEDULE_EMPTY};
+static std::atomic<uint8_t> abort_reason{SCHEDULE_ABORT_NONE};
+
+// Timer callback only, while running
+static esp_timer_handle_t timer = nullptr;
+static int64_t start_us;
+static size_t next_frame;       // next event: this keyframe...
+static uint32_t next_step;      // ...plus this many control periods
+static uint16_t event_seq;
+
+// Keyframe published and not yet applied. The mailbox orders these stores
+// before the control task sees the setpoint.
+static size_t pending_frame;
+static uint16_t pending_seq;
+static uint32_t pending_due_us;
+static std::atomic<bool> pending{false};
+
+static const char* const state_names[] = { "empty", "loaded", "running", "done", "aborted" };
+static const char* const abort_names[] = { "none", "live_command", "deadman", "stopped" };
+
+bool schedule_parse_keyframe(const char* line, size_t len, Keyframe* out) {
+    // strtoul needs a terminator the line doesn't have
+    char num[12];
+    size_t n = 0;
+    while (n < len && n < sizeof(num) - 1 && line[n] >= '0' && line[n] <= '9') n++;
+    if (n == 0 || n == sizeof(num) - 1) return false;
+    memcpy(num, line, n);
+    num[n] = '\0';
+
+    ControlCommand cmd;
+    if (!command_decode_setpoint(line + n, len - n, &cmd)) return false;
+    out->t_ms = (uint32_t)strtoul(num, nullptr, 10);
+    out->flags = cmd.flags;
+    out->throttle = cmd.throttle;
+    out->steering = cmd.steering;
+    return true;
+}
+
+esp_err_t scheduler_load(const Keyframe* list, size_t count, bool interp) {
+    if (state.load() == SCHEDULE_RUNNING) return ESP_ERR_INVALID_STATE;
+    if (count == 0 || count > SCHEDULE_MAX_KEYFRAMES || list[count - 1].throttle != 0) return ESP_ERR_INVALID_ARG;
+    for (size_t i = 1; i < count; i++) {
+        if (list[i].t_ms < list[i - 1].t_ms) return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(frames, list, count * sizeof(Keyframe));
+    frame_count = count;
+    interpolate = interp;
+    for (size_t i = 0; i < count; i++) drift_us[i] = SCHEDULE_NO_DRIFT;
+    abort_reason.store(SCHEDULE_ABORT_NONE);
+    state.store(SCHEDULE_LOADED);
+    ESP_LOGI(TAG, "Loaded %u keyframes over %lu ms", (unsigned int)count, (unsigned long)list[count - 1].t_ms);
+    return ESP_OK;
+}
+
+static int64_t event_offset_us() {
+    return (int64_t)frames[next_frame].t_ms * 1000 + (int64_t)next_step * SCHEDULE_STEP_US;
+}
+
+// Move to the next event, false after the last keyframe
+static bool advance() {
+    if (interpolate && next_frame + 1 < frame_count) {
+        next_step++;
+        if (event_offset_us() < (int64_t)frames[next_frame + 1].t_ms * 1000) return true;
+    }
+    next_frame++;
+    next_step = 0;
+    return next_frame < frame_count;
+}
+
+static int16_t lerp(int16_t a, int16_t b, int64_t num, int64_t den) {
+    return (int16_t)(a + ((int64_t)b - a) * num / den);
+}
+
+static void zero_throttle() {
+    ControlCommand stop = {};
+    stop.kind = CMD_STOP;
+    control_publish(stop);
+}
+
+// esp_timer task: apply the due event, then arm for the next one
+static void schedule_fire(void* arg) {
+    if (state.load(std::memory_order_acquire) != SCHEDULE_RUNNING) return;
+
+    const Keyframe& k = frames[next_frame];
+    ControlCommand setpoint = {};
+    setpoint.kind = CMD_DRIVE;
+    setpoint.flags = k.flags;
+    setpoint.seq = ++event_seq;
+    if (next_step == 0) {
+        setpoint.throttle = k.throttle;
+        setpoint.steering = k.steering;
+        pending_frame = next_frame;
+        pending_seq = setpoint.seq;
+        pending_due_us = (uint32_t)(start_us + event_offset_us());
+        pending.store(true, std::memory_order_release);
+    } else {
+        const Keyframe& to = frames[next_frame + 1];
+        int64_t span = ((int64_t)to.t_ms - k.t_ms) * 1000;
+        int64_t into = (int64_t)next_step * SCHEDULE_STEP_US;
+        setpoint.throttle = lerp(k.throttle, to.throttle, into, span);
+        setpoint.steering = lerp(k.steering, to.steering, into, span);
+    }
+    control_replace(setpoint);
+    control_kick();
+    // An abort that raced with the apply above must still win
+    if (state.load(std::memory_order_acquire) != SCHEDULE_RUNNING) {
+        if (abort_reason.load() == SCHEDULE_ABORT_STOPPED) zero_throttle();
+        return;
+    }
+
+    if (!advance()) {
+        state.store(SCHEDULE_DONE, std::memory_order_release);
+        ESP_LOGI(TAG, "Maneuver done");
+        return;
+    }
+    int64_t wait = start_us + event_offset_us() - esp_timer_get_time();
+    esp_timer_start_once(timer, wait > 0 ? (uint64_t)wait : 0);
+}
+
+esp_err_t scheduler_start() {
+    uint8_t s = state.load();
+    if (s == SCHEDULE_EMPTY) return ESP_ERR_NOT_FOUND;
+    if (s == SCHEDULE_RUNNING || link_state() == LINK_OK) return ESP_ERR_INVALID_STATE;
+    if (!timer) {
+        esp_timer_create_args_t args = {};
+        args.callback = schedule_fire;
+        args.name = "maneuver";
+        ESP_ERROR_CHECK(esp_timer_create(&args, &timer));
+    }
+
+    for (size_t i = 0; i < frame_count; i++) drift_us[i] = SCHEDULE_NO_DRIFT;
+    abort_reason.store(SCHEDULE_ABORT_NONE);
+    next_frame = 0;
+    next_step = 0;
+    pending.store(false);
+    start_us = esp_timer_get_time();
+    state.store(SCHEDULE_RUNNING, std::memory_order_release);
+    ESP_LOGI(TAG, "Running %u keyframes%s", (unsigned int)frame_count, interpolate ? ", interpolated" : "");
+    return esp_timer_start_once(timer, (uint64_t)frames[0].t_ms * 1000);
+}
+
+void scheduler_abort(ScheduleAbort reason) {
+    uint8_t running = SCHEDULE_RUNNING;
+    if (!state.compare_exchange_strong(running, SCHEDULE_ABORTED, std::memory_order_acq_rel)) return;
+    abort_reason.store(reason);
+    esp_timer_stop(timer);
+    ESP_LOGW(TAG, "Maneuver aborted: %s", abort_names[reason]);
+    if (reason == SCHEDULE_ABORT_STOPPED) zero_throttle();
+}
+
+bool scheduler_running() {
+    return state.load(std::memory_order_acquire) == SCHEDULE_RUNNING;
+}
+
+void scheduler_applied(const ControlCommand& setpoint) {
+    if (!pending.load(std::memory_order_acquire) || setpoint.seq != pending_seq) return;
+    drift_us[pending_frame] = (int32_t)((uint32_t)esp_timer_get_time() - pending_due_us);
+    pending.store(false, std::memory_order_relaxed);
+}
+
+// Max and mean |drift| over the keyframes applied so far
+static size_t drift_summary(int32_t* max_us, int32_t* mean_us) {
+    int64_t sum = 0;
+    size_t n = 0;
+    *max_us = 0;
+    for (size_t i = 0; i < frame_count; i++) {
+        if (drift_us[i] == SCHEDULE_NO_DRIFT) continue;
+        int32_t d = drift_us[i] < 0 ? -drift_us[i] : drift_us[i];
+        if (d > *max_us) *max_us = d;
+        sum += d;
+        n++;
+    }
+    *mean_us = n ? (int32_t)(sum / (int64_t)n) : 0;
+    return n;
+}
+
+void scheduler_format(metrics_emit_fn emit, void* ctx) {
+    int32_t max_us, mean_us;
+    size_t applied = drift_summary(&max_us, &mean_us);
+    char line[160];
+    snprintf(line, sizeof(line), "maneuver state=%s keyframes=%u applied=%u drift_max_us=%ld drift_mean_us=%ld abort=%s\n",
+             state_names[state.load()], (unsigned int)frame_count, (unsigned int)applied, (long)max_us,
+             (long)mean_us, abort_names[abort_reason.load()]);
+    emit(ctx, line);
+}
+
+void scheduler_report(metrics_emit_fn emit, void* ctx) {
+    scheduler_format(emit, ctx);
+    char line[96];
+    for (size_t i = 0; i < frame_count; i++) {
+        const Keyframe& k = frames[i];
+        int n = snprintf(line, sizeof(line), "keyframe %u t_ms=%lu throttle=%d steering=%d flags=%u drift_us=",
+                         (unsigned int)i, (unsigned long)k.t_ms, k.throttle, k.steering, k.flags);
+        if (drift_us[i] == SCHEDULE_NO_DRIFT) snprintf(line + n, sizeof(line) - n, "-\n");
+        else snprintf(line + n, sizeof(line) - n, "%ld\n", (long)drift_us[i]);
+        emit(ctx, line);
+    }
+}
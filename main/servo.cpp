@@ -1,20 +1,43 @@
 #include "includes/servo.hpp"
+#include "includes/pwm_profile.hpp"
 #include "driver/ledc.h"
 #include "esp_log.h"
 
 static const char* TAG = "Servo";
 
-Servo::Servo(int gpio_pin) : pin_(gpio_pin) {}
+Servo::Servo(int gpio_pin, const ServoConfig& config) : pin_(gpio_pin), config_(config) {}
+
+esp_err_t Servo::init() {
+    const ServoCalibration& cal = config_.cal;
+    if (config_.freq_hz == 0) {
+        ESP_LOGE(TAG, "No refresh rate");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (cal.min_us > cal.center_us || cal.center_us > cal.max_us) {
+        ESP_LOGE(TAG, "Calibration %u/%u/%u us out of order", cal.min_us, cal.center_us, cal.max_us);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (cal.max_us >= 1000000 / config_.freq_hz) {
+        ESP_LOGE(TAG, "Pulse %u us does not fit a %u Hz frame", cal.max_us, (unsigned int)config_.freq_hz);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // As fine as the clock allows at this refresh rate, capped to the 16-bit table
+    res_bits_ = pwm_max_resolution_bits(LEDC_SRC_CLK_HZ, config_.freq_hz, 16);
+    servo_build_lut(lut_, config_.cal, config_.freq_hz, res_bits_);
 
-void Servo::init() {
     ledc_timer_config_t tt = {
         .speed_mode = LEDC_LOW_SPEED_MODE,
-        .duty_resolution = RES,
+        .duty_resolution = (ledc_timer_bit_t)res_bits_,
         .timer_num = TIMER,
-        .freq_hz = FREQ,
+        .freq_hz = config_.freq_hz,
         .clk_cfg = LEDC_AUTO_CLK
     };
-    ledc_timer_config(&tt);
+    esp_err_t err = ledc_timer_config(&tt);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "PWM timer config failed (err=%d)", err);
+        return err;
+    }
 
     ledc_channel_config_t ch = {
         .gpio_num = pin_,
@@ -26,8 +49,10 @@ void Servo::init() {
     };
     ledc_channel_config(&ch);
     // center servo
-    writeAngle(90);
-    ESP_LOGI(TAG, "Servo initialized on pin %d", pin_);
+    writePosition(0);
+    ESP_LOGI(TAG, "Servo initialized on pin %d (%u Hz, %u bit)", pin_,
+             (unsigned int)config_.freq_hz, (unsigned int)res_bits_);
+    return ESP_OK;
 }
 
 uint32_t Servo::angleToDutyUs(int angle){
@@ -36,13 +61,13 @@ uint32_t Servo::angleToDutyUs(int angle){
     return (uint32_t)duty_us;
 }
 
+void Servo::writeMicros(uint32_t us){
+    ledc_set_duty(LEDC_LOW_SPEED_MODE, CHANNEL, servo_us_to_duty(us, config_.freq_hz, res_bits_));
+    ledc_update_duty(LEDC_LOW_SPEED_MODE, CHANNEL);
+}
+
 void Servo::writeAngle(int angle){
     if(angle < 0) angle = 0;
     if(angle > 180) angle = 180;
-    uint32_t duty_us = angleToDutyUs(angle);
-    // convert microseconds to duty for RES resolution and FREQ
-    uint32_t max_duty = (1 << RES) - 1;
-    uint32_t duty = (uint32_t)(((uint64_t)duty_us * FREQ * max_duty) / 1000000ULL);
-    ledc_set_duty(LEDC_LOW_SPEED_MODE, CHANNEL, duty);
-    ledc_update_duty(LEDC_LOW_SPEED_MODE, CHANNEL);
+    writeMicros(angleToDutyUs(angle));
 }
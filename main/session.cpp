@@ -0,0 +1,217 @@
+#include "includes/session.hpp"
+#include "includes/boot_report.hpp"
+#include "includes/control_task.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char* TAG = "session";
+
+static constexpr int SESSION_FREE = -1;
+static constexpr int SESSION_DELETED = -2;     // keeps probe chains intact
+static constexpr uint32_t RATE_COST_MS = 1000 / SESSION_RATE_HZ;
+
+static Session table[SESSION_TABLE_SIZE];
+static Session* driver = nullptr;
+static bool table_ready = false;
+
+static const char* const role_names[] = { "http", "spectator", "driver" };
+
+static void table_init() {
+    for (Session& s : table) s.fd = SESSION_FREE;
+    table_ready = true;
+}
+
+static inline size_t slot_of(int fd) {
+    // lwIP hands out consecutive fds, so the low bits spread well
+    return (size_t)fd & (SESSION_TABLE_SIZE - 1);
+}
+
+Session* session_get(int fd) {
+    if (fd < 0 || !table_ready) return nullptr;
+    size_t slot = slot_of(fd);
+    for (size_t i = 0; i < SESSION_TABLE_SIZE; i++) {
+        Session& s = table[(slot + i) & (SESSION_TABLE_SIZE - 1)];
+        if (s.fd == fd) return &s;
+        if (s.fd == SESSION_FREE) return nullptr;
+    }
+    return nullptr;
+}
+
+static uint32_t peer_ip(int fd) {
+    sockaddr_storage addr = {};
+    socklen_t len = sizeof(addr);
+    if (getpeername(fd, (sockaddr*)&addr, &len) != 0) return 0;
+    if (addr.ss_family == AF_INET) return ((sockaddr_in*)&addr)->sin_addr.s_addr;
+    if (addr.ss_family != AF_INET6) return 0;
+
+    // httpd listens on IPv6 with IPv4-mapped peers
+    uint32_t ip;
+    memcpy(&ip, &((sockaddr_in6*)&addr)->sin6_addr.s6_addr[12], sizeof(ip));
+    return ip;
+}
+
+esp_err_t session_open(int fd, uint32_t now_ms) {
+    if (!table_ready) table_init();
+    if (session_get(fd)) session_close(fd);    // fd reused without a close
+
+    size_t slot = slot_of(fd);
+    for (size_t i = 0; i < SESSION_TABLE_SIZE; i++) {
+        Session& s = table[(slot + i) & (SESSION_TABLE_SIZE - 1)];
+        if (s.fd != SESSION_FREE && s.fd != SESSION_DELETED) continue;
+
+        s.role.store(ROLE_HTTP, std::memory_order_relaxed);
+        s.spectator_only = false;
+        s.opened_ms = now_ms;
+        s.last_seen_ms = now_ms;
+        s.last_command_ms = 0;
+        s.rate_tat_ms = now_ms;
+        freshness_reset(&s.freshness);
+        s.ack.store((uint32_t)FRESHNESS_LAG_UNKNOWN << 16, std::memory_order_relaxed);
+        s.rtt = {};
+        s.stats = {};
+        s.peer_ip = peer_ip(fd);
+        s.fd = fd;
+        return ESP_OK;
+    }
+    ESP_LOGW(TAG, "Session table full, refusing fd %d", fd);
+    return ESP_FAIL;
+}
+
+void session_close(int fd) {
+    Session* s = session_get(fd);
+    if (!s) return;
+    if (s == driver) {
+        ESP_LOGI(TAG, "Driver fd %d left", fd);
+        driver = nullptr;
+    }
+    s->fd = SESSION_DELETED;
+}
+
+void session_upgrade(Session* s, bool spectator_only) {
+    s->spectator_only = spectator_only;
+    s->role.store(ROLE_SPECTATOR, std::memory_order_relaxed);
+}
+
+// Generic cell rate algorithm: each command pushes the theoretical arrival
+// time one period out; more than BURST periods ahead of now means too fast
+static bool rate_allow(Session* s, uint32_t now_ms) {
+    uint32_t tat = (int32_t)(s->rate_tat_ms - now_ms) > 0 ? s->rate_tat_ms : now_ms;
+    if (tat - now_ms > RATE_COST_MS * SESSION_RATE_BURST) return false;
+    s->rate_tat_ms = tat + RATE_COST_MS;
+    return true;
+}
+
+static bool claim_driver(Session* s, const ControlCommand& cmd, uint32_t now_ms) {
+    if (s == driver) return true;
+    if (s->spectator_only) return false;
+
+    if (driver && s->peer_ip != 0 && s->peer_ip == driver->peer_ip) {
+        // Same client on another socket. A reloaded page or restarted app
+        // counts seq and ts from scratch, so the driver's filter only comes
+        // along if this frame continues its sequence. The socket's own
+        // filter (fresh on a new socket) must pass it either way, or a
+        // demoted socket's late retransmit would take the car back.
+        FreshnessFilter own = s->freshness;
+        if (freshness_check(&own, cmd, now_ms) != FRESH_OK) return false;
+        FreshnessFilter carried = driver->freshness;
+        if (freshness_check(&carried, cmd, now_ms) == FRESH_OK) s->freshness = driver->freshness;
+        ESP_LOGD(TAG, "Driver moves from fd %d to fd %d", driver->fd, s->fd);
+        driver->role.store(ROLE_SPECTATOR, std::memory_order_relaxed);
+        driver = s;
+        s->role.store(ROLE_DRIVER, std::memory_order_relaxed);
+        return true;
+    }
+    if (driver && now_ms - driver->last_command_ms < SESSION_DRIVER_TIMEOUT_MS) return false;
+
+    if (driver) {
+        ESP_LOGI(TAG, "fd %d takes over from idle driver fd %d", s->fd, driver->fd);
+        driver->role.store(ROLE_SPECTATOR, std::memory_order_relaxed);
+    } else {
+        ESP_LOGI(TAG, "fd %d is driving", s->fd);
+    }
+    driver = s;
+    s->role.store(ROLE_DRIVER, std::memory_order_relaxed);
+    return true;
+}
+
+SessionVerdict session_admit(Session* s, const ControlCommand& cmd, uint32_t now_ms) {
+    s->stats.frames++;
+    s->last_seen_ms = now_ms;
+
+    if (!rate_allow(s, now_ms)) {
+        s->stats.rate_limited++;
+        return SESSION_RATE_LIMITED;
+    }
+    if (!claim_driver(s, cmd, now_ms)) {
+        s->stats.not_driver++;
+        return SESSION_NOT_DRIVER;
+    }
+    // Late retransmits and reordered frames must not undo newer intent
+    if (freshness_check(&s->freshness, cmd, now_ms) != FRESH_OK) {
+        s->stats.stale++;
+        return SESSION_STALE;
+    }
+
+    s->stats.accepted++;
+    s->last_command_ms = now_ms;
+    link_command_accepted(s->rtt);
+    s->ack.store(s->freshness.last_seq | ((uint32_t)s->freshness.lag_ms << 16), std::memory_order_relaxed);
+    return SESSION_ACCEPT;
+}
+
+SessionVerdict session_submit(int fd, ControlCommand& cmd, int64_t rx_time) {
+    uint32_t rx_us = (uint32_t)rx_time;
+    // Not rx_us / 1000: that jumps back every time the 32-bit us count wraps
+    uint32_t rx_ms = (uint32_t)(rx_time / 1000);
+
+    // Spectators, floods and stale commands stop here, before the control path
+    Session* s = session_get(fd);
+    SessionVerdict verdict = s ? session_admit(s, cmd, rx_ms) : SESSION_NOT_DRIVER;
+    if (verdict != SESSION_ACCEPT) {
+        metrics_count(verdict == SESSION_STALE ? METRIC_STALE_FRAMES : METRIC_REJECTED_FRAMES);
+        return verdict;
+    }
+
+    cmd.rx_us = rx_us;
+    cmd.parsed_us = (uint32_t)esp_timer_get_time();
+    metrics_count(METRIC_FRAMES);
+    metrics_latency(STAGE_PARSE, cmd.parsed_us - rx_us);
+    control_publish(cmd);
+    boot_mark(BOOT_FIRST_COMMAND);
+    return verdict;
+}
+
+void session_pong(Session* s, const uint8_t* payload, size_t len, uint32_t now_ms) {
+    s->last_seen_ms = now_ms;
+    int32_t rtt = link_pong_rtt(payload, len, now_ms);
+    if (rtt >= 0) link_rtt_sample(&s->rtt, (uint32_t)rtt);
+}
+
+bool session_ack(int fd, uint16_t* seq, uint16_t* lag_ms, SessionRole* role) {
+    Session* s = session_get(fd);
+    if (!s) return false;
+    uint32_t ack = s->ack.load(std::memory_order_relaxed);
+    *seq = (uint16_t)(ack & 0xFFFF);
+    *lag_ms = (uint16_t)(ack >> 16);
+    *role = (SessionRole)s->role.load(std::memory_order_relaxed);
+    return true;
+}
+
+void session_format(metrics_emit_fn emit, void* ctx, uint32_t now_ms) {
+    char line[200];
+    for (const Session& s : table) {
+        if (s.fd < 0) continue;
+        uint8_t role = s.role.load(std::memory_order_relaxed);
+        if (role == ROLE_HTTP) continue;
+        snprintf(line, sizeof(line),
+                 "session fd=%d role=%s age_ms=%lu idle_ms=%lu srtt_ms=%u rttvar_ms=%u frames=%lu accepted=%lu not_driver=%lu rate_limited=%lu stale=%lu\n",
+                 s.fd, role_names[role], (unsigned long)(now_ms - s.opened_ms), (unsigned long)(now_ms - s.last_seen_ms),
+                 s.rtt.srtt_ms, s.rtt.rttvar_ms,
+                 (unsigned long)s.stats.frames, (unsigned long)s.stats.accepted, (unsigned long)s.stats.not_driver,
+                 (unsigned long)s.stats.rate_limited, (unsigned long)s.stats.stale);
+        emit(ctx, line);
+    }
+}
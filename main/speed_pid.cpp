@@ -0,0 +1,64 @@
+#include "includes/speed_pid.hpp"
+#include <string.h>
+
+static int64_t clamp64(int64_t v, int64_t lo, int64_t hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+void speed_pid_init(SpeedPid* pid, const SpeedGains& gains) {
+    memset(pid, 0, sizeof(*pid));
+    pid->gains = gains;
+    pid->out_max = MOTOR_SPEED_MAX;
+}
+
+int32_t speed_pid_step(SpeedPid* pid, int32_t target_mmps, int32_t measured_mmps, uint32_t dt_us) {
+    const SpeedGains& g = pid->gains;
+    int32_t max_step = (int32_t)((int64_t)g.accel_mmps2 * dt_us / 1000000);
+    if (max_step < 1) max_step = 1;
+    pid->setpoint += (int32_t)clamp64((int64_t)target_mmps - pid->setpoint, -max_step, max_step);
+
+    int32_t rate = dt_us ? (int32_t)((int64_t)(measured_mmps - pid->prev_measured) * 1000000 / dt_us) : 0;
+    pid->prev_measured = measured_mmps;
+    // Reversing: coast until the wheel has all but stopped, never drive
+    // against it
+    bool opposed = (pid->setpoint > 0 && measured_mmps < -SPEED_REVERSE_MMPS) ||
+                   (pid->setpoint < 0 && measured_mmps > SPEED_REVERSE_MMPS);
+    if (pid->setpoint == 0 || opposed) {
+        pid->integral = 0;
+        pid->out = 0;
+        return 0;
+    }
+
+    int32_t error = pid->setpoint - measured_mmps;
+    int64_t lo = pid->setpoint > 0 ? 0 : -pid->out_max;
+    int64_t hi = pid->setpoint > 0 ? pid->out_max : 0;
+
+    int64_t base_q16 = (int64_t)g.ff_q16 * pid->setpoint + (int64_t)g.kp_q16 * error - (int64_t)g.kd_q16 * rate;
+    int64_t i_q16 = g.ki_q16 ? (int64_t)g.ki_q16 * (pid->integral / 1000) / 1000 : 0;
+    int64_t out = clamp64((base_q16 + i_q16) / 65536, lo, hi);
+
+    // Anti-windup: stop integrating into a saturated output, and keep the
+    // integral term alone within full scale
+    bool saturated = (out == hi && error > 0) || (out == lo && error < 0);
+    if (!saturated && g.ki_q16) {
+        int64_t limit = (int64_t)MOTOR_SPEED_MAX * 65536 / g.ki_q16 * 1000000;
+        pid->integral = clamp64(pid->integral + (int64_t)error * dt_us, -limit, limit);
+    }
+    pid->out = (int32_t)out;
+    return pid->out;
+}
+
+int32_t speed_estimate(SpeedEstimate* e, int32_t counts, uint32_t now_us, uint32_t counts_per_m) {
+    uint8_t span = e->filled;      // ticks back to the oldest sample kept
+    e->head = (uint8_t)((e->head + 1) % (SPEED_WINDOW_TICKS + 1));
+    e->counts[e->head] = counts;
+    e->time_us[e->head] = now_us;
+    if (e->filled < SPEED_WINDOW_TICKS) e->filled++;
+    if (span == 0) return 0;
+
+    uint8_t oldest = (uint8_t)((e->head + SPEED_WINDOW_TICKS + 1 - span) % (SPEED_WINDOW_TICKS + 1));
+    uint32_t dt_us = now_us - e->time_us[oldest];
+    if (dt_us == 0 || counts_per_m == 0) return 0;
+    // counts / counts_per_m metres over dt_us: mm/s = counts * 1e9 / (counts_per_m * dt_us)
+    return (int32_t)((int64_t)(counts - e->counts[oldest]) * 1000000000LL / ((int64_t)counts_per_m * dt_us));
+}
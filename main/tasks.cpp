@@ -0,0 +1,71 @@
+#include "includes/tasks.hpp"
+#include "esp_log.h"
+#include <atomic>
+#include <stdio.h>
+
+static const char* TAG = "tasks";
+
+static std::atomic<TaskHandle_t> registry[TASK_REGISTRY_SIZE];
+static std::atomic<uint32_t> alloc_counts[TASK_REGISTRY_SIZE];
+
+// Also called from the heap hook, keep it short
+static inline int slot_of(TaskHandle_t task) {
+    for (int i = 0; i < TASK_REGISTRY_SIZE; i++) {
+        if (registry[i].load(std::memory_order_relaxed) == task) return i;
+    }
+    return -1;
+}
+
+void task_register(TaskHandle_t task) {
+    if (!task || slot_of(task) >= 0) return;
+    for (int i = 0; i < TASK_REGISTRY_SIZE; i++) {
+        TaskHandle_t expected = nullptr;
+        if (registry[i].compare_exchange_strong(expected, task, std::memory_order_relaxed)) {
+            alloc_counts[i].store(0, std::memory_order_relaxed);
+            return;
+        }
+    }
+    ESP_LOGW(TAG, "Registry full, %s not tracked", pcTaskGetName(task));
+}
+
+void task_exit() {
+    int slot = slot_of(xTaskGetCurrentTaskHandle());
+    if (slot >= 0) registry[slot].store(nullptr, std::memory_order_relaxed);
+    vTaskDelete(NULL);
+}
+
+// Only the STATIC_ALLOCATION build counts; with the hooks in a heap build
+// every malloc on every task would pay for the registry scan
+#if defined(CONFIG_HEAP_USE_HOOKS) && defined(STATIC_ALLOCATION)
+#include "esp_attr.h"
+
+extern "C" void IRAM_ATTR esp_heap_trace_alloc_hook(void* ptr, size_t size, uint32_t caps) {
+    int slot = slot_of(xTaskGetCurrentTaskHandle());
+    if (slot >= 0) alloc_counts[slot].fetch_add(1, std::memory_order_relaxed);
+}
+
+extern "C" void IRAM_ATTR esp_heap_trace_free_hook(void* ptr) {}
+#endif
+
+uint32_t task_alloc_count() {
+    int slot = slot_of(xTaskGetCurrentTaskHandle());
+    return slot >= 0 ? alloc_counts[slot].load(std::memory_order_relaxed) : 0;
+}
+
+void task_alloc_check(uint32_t mark) {
+    uint32_t n = task_alloc_count() - mark;
+    if (n) metrics_count(METRIC_HOT_PATH_ALLOCS, n);
+}
+
+void task_format(metrics_emit_fn emit, void* ctx) {
+    char line[96];
+    for (int i = 0; i < TASK_REGISTRY_SIZE; i++) {
+        TaskHandle_t task = registry[i].load(std::memory_order_relaxed);
+        if (!task) continue;
+        // Bytes: ESP-IDF's StackType_t is one byte wide
+        snprintf(line, sizeof(line), "task name=%s prio=%u stack_free_min=%u allocs=%lu\n", pcTaskGetName(task),
+                 (unsigned int)uxTaskPriorityGet(task), (unsigned int)uxTaskGetStackHighWaterMark(task),
+                 (unsigned long)alloc_counts[i].load(std::memory_order_relaxed));
+        emit(ctx, line);
+    }
+}
@@ -0,0 +1,232 @@
+#include "includes/telemetry.hpp"
+#include "includes/battery.hpp"
+#include "includes/control_task.hpp"
+#include "includes/led_status.hpp"
+#include "includes/metrics.hpp"
+#include "includes/session.hpp"
+#include "includes/tasks.hpp"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_netif.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "esp_log.h"
+#include "lwip/sockets.h"
+#include <atomic>
+#include <string.h>
+
+static const char* TAG = "telemetry";
+
+// Also the httpd work item for its own send: httpd_ws_send_data_async would
+// calloc one per frame
+struct TelemetryClient {
+    int fd;
+    httpd_handle_t server;
+    std::atomic<bool> in_flight;
+    // Read by the queued send, until in_flight clears
+    uint8_t frame[TELEMETRY_FRAME_SIZE];
+};
+
+static TelemetryClient clients[TELEMETRY_MAX_CLIENTS];
+static uint32_t period_ms;
+
+struct StationRssi {
+    uint32_t ip;    // network byte order
+    int8_t rssi;
+};
+
+static inline void write_u16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void write_u32(uint8_t* p, uint32_t v) {
+    write_u16(p, (uint16_t)(v & 0xFFFF));
+    write_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+size_t telemetry_encode(const TelemetryFrame& f, uint8_t* buf, size_t len) {
+    if (!buf || len < TELEMETRY_FRAME_SIZE) return 0;
+
+    buf[0] = TELEMETRY_FRAME_TYPE;
+    buf[1] = f.lights;
+    write_u16(buf + 2, f.seq);
+    write_u16(buf + 4, (uint16_t)f.throttle);
+    write_u16(buf + 6, (uint16_t)f.steering);
+    write_u16(buf + 8, (uint16_t)f.motor);
+    write_u16(buf + 10, (uint16_t)f.servo);
+    buf[12] = (uint8_t)f.rssi;
+    buf[13] = f.flags;
+    write_u16(buf + 14, f.loop_us);
+    write_u32(buf + 16, f.heap_free);
+    write_u32(buf + 20, f.uptime_ms);
+    write_u16(buf + 24, f.ack_seq);
+    write_u16(buf + 26, f.lag_ms);
+    buf[28] = f.role;
+    write_u16(buf + 29, f.vbat_mv);
+    write_u16(buf + 31, (uint16_t)f.current_ma);
+    buf[33] = f.power_level;
+    return TELEMETRY_FRAME_SIZE;
+}
+
+// httpd task. The client may have closed since the frame was queued.
+static void send_frame(void* arg) {
+    TelemetryClient* c = static_cast<TelemetryClient*>(arg);
+    if (httpd_ws_get_fd_info(c->server, c->fd) == HTTPD_WS_CLIENT_WEBSOCKET) {
+        httpd_ws_frame_t pkt = {};
+        pkt.final = true;
+        pkt.type = HTTPD_WS_TYPE_BINARY;
+        pkt.payload = c->frame;
+        pkt.len = TELEMETRY_FRAME_SIZE;
+        httpd_ws_send_frame_async(c->server, c->fd, &pkt);
+    }
+    c->in_flight.store(false, std::memory_order_release);
+}
+
+// RSSI is per station MAC, sockets only know the peer IP; the AP's DHCP
+// leases join the two
+static size_t station_rssi(StationRssi* out, size_t max) {
+    wifi_sta_list_t sta = {};
+    if (esp_wifi_ap_get_sta_list(&sta) != ESP_OK || sta.num == 0) return 0;
+
+    esp_netif_pair_mac_ip_t pairs[ESP_WIFI_MAX_CONN_NUM] = {};
+    size_t n = (size_t)sta.num < max ? (size_t)sta.num : max;
+    for (size_t i = 0; i < n; i++) {
+        memcpy(pairs[i].mac, sta.sta[i].mac, sizeof(pairs[i].mac));
+    }
+    esp_netif_t* ap = esp_netif_get_handle_from_ifkey("WIFI_AP_DEF");
+    if (!ap || esp_netif_dhcps_get_clients_by_mac(ap, n, pairs) != ESP_OK) return 0;
+
+    for (size_t i = 0; i < n; i++) {
+        out[i].ip = pairs[i].ip.addr;
+        out[i].rssi = sta.sta[i].rssi;
+    }
+    return n;
+}
+
+static int8_t client_rssi(int fd, const StationRssi* stations, size_t count) {
+    sockaddr_storage addr = {};
+    socklen_t len = sizeof(addr);
+    if (getpeername(fd, (sockaddr*)&addr, &len) != 0) return TELEMETRY_RSSI_UNKNOWN;
+
+    uint32_t ip;
+    if (addr.ss_family == AF_INET) {
+        ip = ((sockaddr_in*)&addr)->sin_addr.s_addr;
+    } else {
+        // httpd listens on IPv6 with IPv4-mapped peers
+        memcpy(&ip, &((sockaddr_in6*)&addr)->sin6_addr.s6_addr[12], sizeof(ip));
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (stations[i].ip == ip) return stations[i].rssi;
+    }
+    return TELEMETRY_RSSI_UNKNOWN;
+}
+
+static TelemetryClient* client_slot(int fd) {
+    TelemetryClient* free_slot = nullptr;
+    for (TelemetryClient& c : clients) {
+        if (c.fd == fd) return &c;
+        if (!free_slot && c.fd < 0 && !c.in_flight.load(std::memory_order_acquire)) free_slot = &c;
+    }
+    if (free_slot) free_slot->fd = fd;
+    return free_slot;
+}
+
+void telemetry_broadcast(httpd_handle_t server) {
+    int fds[TELEMETRY_MAX_CLIENTS];
+    size_t fd_count = TELEMETRY_MAX_CLIENTS;
+    if (httpd_get_client_list(server, &fd_count, fds) != ESP_OK) return;
+
+    // Forget sessions that went away, once their last send has completed
+    for (TelemetryClient& c : clients) {
+        if (c.fd < 0) continue;
+        bool open = false;
+        for (size_t i = 0; i < fd_count; i++) open |= fds[i] == c.fd;
+        if (!open) c.fd = -1;
+    }
+
+    TelemetryFrame frame = {};
+    ControlStatus status;
+    if (control_status(&status)) {
+        frame.seq = status.seq;
+        frame.flags = status.flags;
+        frame.throttle = status.throttle;
+        frame.steering = status.steering;
+        frame.motor = status.motor;
+        frame.servo = status.servo;
+        frame.loop_us = status.loop_us;
+    }
+    LightLayers lights;
+    lights_get(&lights);
+    frame.lights = (lights.headlights ? TELEMETRY_LIGHT_HEADLIGHTS : 0) |
+                   (lights.braking ? TELEMETRY_LIGHT_BRAKING : 0) |
+                   (lights.reversing ? TELEMETRY_LIGHT_REVERSING : 0) |
+                   (lights.hazard ? TELEMETRY_LIGHT_HAZARD : 0) |
+                   (lights.indicator < 0 ? TELEMETRY_LIGHT_LEFT : 0) |
+                   (lights.indicator > 0 ? TELEMETRY_LIGHT_RIGHT : 0);
+    BatteryStatus battery;
+    if (battery_status(&battery)) {
+        frame.vbat_mv = battery.vbat_mv;
+        frame.current_ma = battery.current_ma;
+        frame.power_level = battery.level;
+    }
+    frame.heap_free = esp_get_free_heap_size();
+    frame.uptime_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    StationRssi stations[ESP_WIFI_MAX_CONN_NUM];
+    size_t station_count = 0;
+    bool stations_read = false;
+
+    for (size_t i = 0; i < fd_count; i++) {
+        if (httpd_ws_get_fd_info(server, fds[i]) != HTTPD_WS_CLIENT_WEBSOCKET) continue;
+
+        TelemetryClient* c = client_slot(fds[i]);
+        if (!c) continue;
+        // Previous frame still queued: this client is slow, don't let it
+        // hold up the others. The send itself runs on the control server's
+        // task and gives up after the WS socket's short send timeout.
+        if (c->in_flight.load(std::memory_order_acquire)) {
+            metrics_count(METRIC_TELEMETRY_SKIPPED);
+            continue;
+        }
+
+        if (!stations_read) {
+            station_count = station_rssi(stations, ESP_WIFI_MAX_CONN_NUM);
+            stations_read = true;
+        }
+        frame.rssi = client_rssi(fds[i], stations, station_count);
+        SessionRole role;
+        if (session_ack(fds[i], &frame.ack_seq, &frame.lag_ms, &role)) {
+            frame.role = role;
+        } else {
+            frame.ack_seq = 0;
+            frame.lag_ms = FRESHNESS_LAG_UNKNOWN;
+            frame.role = ROLE_SPECTATOR;
+        }
+        telemetry_encode(frame, c->frame, sizeof(c->frame));
+
+        c->server = server;
+        c->in_flight.store(true, std::memory_order_release);
+        if (httpd_queue_work(server, send_frame, c) != ESP_OK) {
+            c->in_flight.store(false, std::memory_order_release);
+        }
+    }
+}
+
+static void telemetry_task(void* param) {
+    httpd_handle_t server = static_cast<httpd_handle_t>(param);
+    TickType_t last_wake = xTaskGetTickCount();
+    while (true) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(period_ms));
+        telemetry_broadcast(server);
+    }
+}
+
+void telemetry_start(httpd_handle_t server, uint32_t rate_hz) {
+    for (TelemetryClient& c : clients) c.fd = -1;
+    period_ms = 1000 / rate_hz;
+    static TaskStorage<3072> storage;
+    task_spawn(telemetry_task, "telemetry", server, 2, storage);
+    ESP_LOGI(TAG, "Broadcasting telemetry at %u Hz", (unsigned int)rate_hz);
+}
@@ -0,0 +1,184 @@
+#include "includes/udp_control.hpp"
+#include "includes/command.hpp"
+#include "includes/mailbox.hpp"
+#include "includes/session.hpp"
+#include "includes/tasks.hpp"
+#include "includes/web_server.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char* TAG = "udp_control";
+
+struct PendingCommand {
+    ControlCommand cmd;
+    int64_t rx_time;
+    bool resync;        // first packet of a new sequence
+};
+
+static httpd_handle_t udp_server = nullptr;
+static int udp_sock = -1;
+static uint8_t udp_key[CONTROL_UDP_KEY_SIZE];
+
+// UDP task only
+static bool have_seq = false;
+static uint16_t last_seq;
+static uint32_t last_rx_ms;
+static uint32_t last_client_ms;    // of the newest packet taken, across resyncs
+
+static LatestMailbox<PendingCommand> pending;
+static std::atomic<bool> work_queued{false};
+
+static std::atomic<uint32_t> stat_packets, stat_bad_tag, stat_reordered, stat_lost, stat_replayed, stat_rejected;
+
+// Runs on the httpd task
+static void admit_pending(void* arg) {
+    // Cleared before taking, so a packet published meanwhile queues new work
+    work_queued.store(false, std::memory_order_release);
+    PendingCommand p;
+    if (!pending.take(&p)) return;
+
+    Session* s = session_get(udp_sock);
+    if (s && p.resync) freshness_reset(&s->freshness);
+    if (session_submit(udp_sock, p.cmd, p.rx_time) != SESSION_ACCEPT) {
+        stat_rejected.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// Runs on the httpd task, the session table's only writer
+static void open_session(void* arg) {
+    int sock = (int)(intptr_t)arg;
+    if (session_open(sock, (uint32_t)(esp_timer_get_time() / 1000)) != ESP_OK) {
+        ESP_LOGE(TAG, "No session for the UDP listener, its packets will be rejected");
+    }
+}
+
+bool udp_control_open(httpd_handle_t server, uint16_t port, const uint8_t* key) {
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "socket failed");
+        return false;
+    }
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(sock, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        ESP_LOGE(TAG, "bind to port %u failed", port);
+        close(sock);
+        return false;
+    }
+    timeval timeout = {};
+    timeout.tv_usec = UDP_CONTROL_POLL_MS * 1000;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    // Queued ahead of any admission work, so the session is there first
+    if (httpd_queue_work(server, open_session, (void*)(intptr_t)sock) != ESP_OK) {
+        ESP_LOGE(TAG, "Could not register the UDP session");
+        close(sock);
+        return false;
+    }
+    memcpy(udp_key, key, sizeof(udp_key));
+    udp_server = server;
+    udp_sock = sock;
+    ESP_LOGI(TAG, "Listening on UDP port %u", port);
+    return true;
+}
+
+bool udp_control_poll() {
+    // One spare byte so oversized datagrams fail the length check
+    uint8_t buf[CONTROL_UDP_SIZE + 1];
+    int n = recv(udp_sock, buf, sizeof(buf), 0);
+    if (n < 0) return false;
+
+    int64_t rx_time = esp_timer_get_time();
+    uint32_t rx_ms = (uint32_t)(rx_time / 1000);
+    stat_packets.fetch_add(1, std::memory_order_relaxed);
+
+    PendingCommand p;
+    if (!command_decode_udp(buf, (size_t)n, udp_key, &p.cmd)) {
+        stat_bad_tag.fetch_add(1, std::memory_order_relaxed);
+        metrics_count(METRIC_PARSE_ERRORS);
+        return true;
+    }
+
+    // Newest wins: anything not ahead of the last packet is already superseded
+    p.resync = !have_seq || rx_ms - last_rx_ms > UDP_CONTROL_RESYNC_MS;
+    if (p.resync) {
+        // The tag covers the frame only: a new sequence must at least be
+        // stamped later than the last one, or a captured datagram could be
+        // replayed whenever the client pauses
+        if (have_seq && (int32_t)(p.cmd.client_ms - last_client_ms) <= 0) {
+            stat_replayed.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    } else {
+        int16_t gap = (int16_t)(p.cmd.seq - last_seq);
+        if (gap <= 0) {
+            stat_reordered.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        if (gap > 1) stat_lost.fetch_add(gap - 1, std::memory_order_relaxed);
+    }
+    have_seq = true;
+    last_seq = p.cmd.seq;
+    last_rx_ms = rx_ms;
+    last_client_ms = p.cmd.client_ms;
+
+    p.rx_time = rx_time;
+    pending.publish(p);
+    if (!work_queued.exchange(true, std::memory_order_acq_rel) &&
+        httpd_queue_work(udp_server, admit_pending, nullptr) != ESP_OK) {
+        work_queued.store(false, std::memory_order_release);
+    }
+    return true;
+}
+
+static void udp_control_task(void* param) {
+    while (true) udp_control_poll();
+}
+
+void udp_control_start(httpd_handle_t server) {
+#ifdef CONFIG_ESPDRIVE_UDP_KEY
+    const char* key = CONFIG_ESPDRIVE_UDP_KEY;
+#else
+    const char* key = "";
+#endif
+    // A published default key would let anyone on the AP drive
+    if (strlen(key) != CONTROL_UDP_KEY_SIZE) {
+        ESP_LOGE(TAG, "UDP control off: set CONFIG_ESPDRIVE_UDP_KEY to %d characters", CONTROL_UDP_KEY_SIZE);
+        return;
+    }
+    if (!udp_control_open(server, UDP_CONTROL_PORT, (const uint8_t*)key)) return;
+    // Same priority as the control httpd, which does the admission
+    static TaskStorage<3072> storage;
+    task_spawn(udp_control_task, "udp_control", NULL, CONTROL_HTTPD_PRIORITY, storage);
+}
+
+UdpControlStats udp_control_stats() {
+    UdpControlStats s;
+    s.packets = stat_packets.load(std::memory_order_relaxed);
+    s.bad_tag = stat_bad_tag.load(std::memory_order_relaxed);
+    s.reordered = stat_reordered.load(std::memory_order_relaxed);
+    s.lost = stat_lost.load(std::memory_order_relaxed);
+    s.replayed = stat_replayed.load(std::memory_order_relaxed);
+    s.rejected = stat_rejected.load(std::memory_order_relaxed);
+    return s;
+}
+
+void udp_control_format(metrics_emit_fn emit, void* ctx) {
+    if (udp_sock < 0) return;
+    UdpControlStats s = udp_control_stats();
+    char line[160];
+    snprintf(line, sizeof(line), "udp packets=%lu bad_tag=%lu reordered=%lu lost=%lu replayed=%lu rejected=%lu\n",
+             (unsigned long)s.packets, (unsigned long)s.bad_tag, (unsigned long)s.reordered,
+             (unsigned long)s.lost, (unsigned long)s.replayed, (unsigned long)s.rejected);
+    emit(ctx, line);
+}
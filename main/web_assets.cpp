@@ -0,0 +1,19 @@
+#ifdef WEB_ASSETS_EMBEDDED
+#include "includes/web_assets.hpp"
+#include <string.h>
+
+const WebAsset* web_asset_find(const char* path, size_t len) {
+    size_t lo = 0;
+    size_t hi = WEB_ASSETS_COUNT;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        const char* p = WEB_ASSETS[mid].path;
+        int cmp = strncmp(p, path, len);
+        if (cmp == 0 && p[len] != '\0') cmp = 1;   // longer entry sorts after the key
+        if (cmp == 0) return &WEB_ASSETS[mid];
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return NULL;
+}
+#endif
@@ -1,217 +1,686 @@
+#include "includes/battery.hpp"
+#include "includes/boot_report.hpp"
+#include "includes/command.hpp"
+#include "includes/control_task.hpp"
 #include "includes/controls.hpp"
 #include "includes/web_server.hpp"
+#include "includes/event_log.hpp"
+#include "includes/link.hpp"
+#include "includes/metrics.hpp"
+#include "includes/recorder.hpp"
+#include "includes/scheduler.hpp"
+#include "includes/session.hpp"
+#include "includes/tasks.hpp"
+#include "includes/telemetry.hpp"
+#include "includes/udp_control.hpp"
+#include "includes/web_assets.hpp"
 #include "esp_http_server.h"
 #include "esp_spiffs.h"
 #include "esp_vfs.h"
 #include "esp_log.h"
-#include "cJSON.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include <stdio.h>
+#include <string.h>
 #include <string>
+#include <unistd.h>
 
 static const char* TAG = "web_server";
 
-static httpd_handle_t server = nullptr;
-static int client_session_id;
+#ifdef CONFIG_LWIP_MAX_SOCKETS
+// Whichever socket opens past the limit would fail at runtime instead
+static_assert(SOCKET_BUDGET <= CONFIG_LWIP_MAX_SOCKETS, "raise CONFIG_LWIP_MAX_SOCKETS or shrink the httpd socket counts");
+#endif
 
+static httpd_handle_t control_server = nullptr;
+static httpd_handle_t asset_server = nullptr;
+
+// Text (JSON) WS frames land here; only the control server's task uses it
+static uint8_t ws_text_buf[WS_MAX_SIZE];
+
+static esp_err_t ws_open(httpd_handle_t hd, int fd) {
+    // Runs on the control server's task, put it on the task report
+    task_register(xTaskGetCurrentTaskHandle());
+    return session_open(fd, (uint32_t)(esp_timer_get_time() / 1000));
+}
+
+static void ws_close(httpd_handle_t hd, int fd) {
+    session_close(fd);
+    close(fd);
+}
+
+// Header value contains `token`; values longer than the buffer are matched on
+// the part that fit
+static bool header_contains(httpd_req_t *req, const char* field, const char* token) {
+    char value[128];
+    esp_err_t err = httpd_req_get_hdr_value_str(req, field, value, sizeof(value));
+    if (err != ESP_OK && err != ESP_ERR_HTTPD_RESULT_TRUNC) return false;
+    return strstr(value, token) != NULL;
+}
+
+static esp_err_t redirect_home(httpd_req_t *req) {
+    httpd_resp_set_status(req, "301 Moved Permanently");
+    httpd_resp_set_hdr(req, "Location", "/");
+    httpd_resp_send(req, NULL, 0);
+    return ESP_OK;
+}
+
+// Caching headers for the asset at `path` (relative to app/dist). Returns
+// true when the client's copy is current and a 304 was sent.
+static bool send_asset_headers(httpd_req_t *req, const char* path, const char* etag, bool gzip) {
+    // Vite content-hashes everything under /assets, the rest (index.html,
+    // sw.js, manifest) must be revalidated so updates are picked up
+    bool hashed = strncmp(path, "/assets/", strlen("/assets/")) == 0;
+    httpd_resp_set_hdr(req, "Cache-Control", hashed ? "public, max-age=31536000, immutable" : "no-cache");
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    if (gzip) httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+
+    if (!header_contains(req, "If-None-Match", etag)) return false;
+    httpd_resp_set_status(req, "304 Not Modified");
+    httpd_resp_send(req, NULL, 0);
+    return true;
+}
+
+#ifdef WEB_ASSETS_EMBEDDED
+// Assets compiled into the image: one table lookup, sent straight from flash.
+// Only one representation is embedded per path (the .gz one when
+// build_frontend made it), every browser the UI targets accepts gzip.
 static esp_err_t static_get_handler(httpd_req_t *req) {
-    // Mount SPIFFS
-    esp_vfs_spiffs_conf_t esp_vfs_spiffs_conf = {
+    size_t uri_len = strcspn(req->uri, "?");
+    const WebAsset* asset = uri_len == 1 ? web_asset_find("/index.html", strlen("/index.html"))
+                                         : web_asset_find(req->uri, uri_len);
+    if (asset == NULL) {
+        const char* slash = strrchr(req->uri, '/');
+        const char* ext = strchr(slash ? slash : req->uri, '.');
+        if (ext == NULL || strncmp(ext, ".local", strlen(".local")) == 0) return redirect_home(req);
+        httpd_resp_send_404(req);
+        return ESP_OK;
+    }
+
+    httpd_resp_set_type(req, asset->mime);
+    if (send_asset_headers(req, asset->path, asset->etag, asset->gzip)) return ESP_OK;
+    return httpd_resp_send(req, (const char*)asset->data, asset->len);
+}
+#else
+struct AssetType {
+    const char* ext;
+    const char* mime;
+};
+
+static const AssetType ASSET_TYPES[] = {
+    { ".html", "text/html" },
+    { ".js", "text/javascript" },
+    { ".css", "text/css" },
+    { ".json", "application/json" },
+    { ".webmanifest", "application/manifest+json" },
+    { ".png", "image/png" },
+    { ".svg", "image/svg+xml" },
+    { ".ico", "image/x-icon" },
+    { ".woff2", "font/woff2" },
+    { ".txt", "text/plain" },
+};
+
+struct EtagEntry {
+    char path[STATIC_PATH_MAX];
+    char etag[24];
+};
+
+// Only touched from the httpd task, which serves one request at a time
+static EtagEntry etag_cache[ETAG_CACHE_SIZE];
+static int etag_cache_used;
+static char chunk_buf[STATIC_CHUNK_SIZE];
+
+static const char* asset_type(const char* ext) {
+    for (const AssetType& t : ASSET_TYPES) {
+        if (strcmp(ext, t.ext) == 0) return t.mime;
+    }
+    return "application/octet-stream";
+}
+
+// Strong ETag for the file at `path`: FNV-1a of its contents plus its size.
+// Hashed on first request, the SPIFFS image doesn't change until reflashed.
+static const char* etag_for(const char* path, FILE* file) {
+    for (int i = 0; i < etag_cache_used; i++) {
+        if (strcmp(etag_cache[i].path, path) == 0) return etag_cache[i].etag;
+    }
+
+    uint32_t hash = 2166136261u;
+    size_t size = 0;
+    size_t n;
+    while ((n = fread(chunk_buf, 1, sizeof(chunk_buf), file)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            hash = (hash ^ (uint8_t)chunk_buf[i]) * 16777619u;
+        }
+        size += n;
+    }
+    rewind(file);
+
+    // Full cache: recycle the last slot rather than rehash every request
+    int slot = etag_cache_used < ETAG_CACHE_SIZE ? etag_cache_used++ : ETAG_CACHE_SIZE - 1;
+    EtagEntry& e = etag_cache[slot];
+    snprintf(e.path, sizeof(e.path), "%s", path);
+    snprintf(e.etag, sizeof(e.etag), "\"%08lx-%lx\"", (unsigned long)hash, (unsigned long)size);
+    return e.etag;
+}
+
+// Queued on the asset server right after it starts, so it runs before the
+// first request there and never delays the control server coming up
+static void mount_assets(void* arg) {
+    task_register(xTaskGetCurrentTaskHandle());
+    esp_vfs_spiffs_conf_t conf = {
         .base_path = "/spiffs",
         .partition_label = NULL,
         .max_files = 5,
-        .format_if_mount_failed = true};
-    esp_vfs_spiffs_register(&esp_vfs_spiffs_conf);
+        .format_if_mount_failed = true
+    };
+    esp_err_t err = esp_vfs_spiffs_register(&conf);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "SPIFFS mount failed: %s", esp_err_to_name(err));
+        return;
+    }
+    boot_mark(BOOT_ASSETS);
+}
 
-    char path[600];
-    if (strcmp(req->uri, "/") == 0) {
+static esp_err_t static_get_handler(httpd_req_t *req) {
+    // SPIFFS is mounted once, by mount_assets()
+    char path[STATIC_PATH_MAX];
+    size_t uri_len = strcspn(req->uri, "?");
+    if (uri_len == 1 && req->uri[0] == '/') {
         strcpy(path, "/spiffs/index.html");
+    } else if (uri_len + strlen("/spiffs.gz") < sizeof(path)) {
+        snprintf(path, sizeof(path), "/spiffs%.*s", (int)uri_len, req->uri);
     } else {
-        sprintf(path, "/spiffs%s", req->uri);
+        httpd_resp_send_404(req);
+        return ESP_OK;
     }
 
     char *ext = strrchr(path, '.');
     if (ext == NULL || strncmp(ext, ".local", strlen(".local")) == 0) {
-        httpd_resp_set_status(req, "301 Moved Permanently");
-        httpd_resp_set_hdr(req, "Location", "/");
-        httpd_resp_send(req, NULL, 0);
-        return ESP_OK;
-    }
-    if (strcmp(ext, ".css") == 0) {
-        httpd_resp_set_type(req, "text/css");
-    } 
-    if (strcmp(ext, ".js") == 0) {
-        httpd_resp_set_type(req, "text/javascript");
-    }
-    if (strcmp(ext, ".png") == 0) {
-        httpd_resp_set_type(req, "image/png");
+        return redirect_home(req);
     }
+    httpd_resp_set_type(req, asset_type(ext));
 
-    FILE *file = fopen(path, "r");
+    // Prefer the precompressed copy build_frontend writes next to each asset
+    FILE *file = NULL;
+    bool gzip = false;
+    if (header_contains(req, "Accept-Encoding", "gzip")) {
+        size_t len = strlen(path);
+        strcpy(path + len, ".gz");
+        file = fopen(path, "rb");
+        gzip = file != NULL;
+        if (!gzip) path[len] = '\0';
+    }
+    if (!file) file = fopen(path, "rb");
     if (file == NULL) {
         httpd_resp_send_404(req);
-        esp_vfs_spiffs_unregister(NULL);
         return ESP_OK;
     }
 
-    char lineRead[256];
-    while (fgets(lineRead, sizeof(lineRead), file)) {
-        httpd_resp_sendstr_chunk(req, lineRead);
+    const char* etag = etag_for(path, file);
+    if (send_asset_headers(req, path + strlen("/spiffs"), etag, gzip)) {
+        fclose(file);
+        return ESP_OK;
     }
-    httpd_resp_sendstr_chunk(req, NULL);
 
-    esp_vfs_spiffs_unregister(NULL);
+    size_t n;
+    while ((n = fread(chunk_buf, 1, sizeof(chunk_buf), file)) > 0) {
+        if (httpd_resp_send_chunk(req, chunk_buf, n) != ESP_OK) {
+            fclose(file);
+            ESP_LOGE(TAG, "Sending %s failed", path);
+            return ESP_FAIL;
+        }
+    }
+    fclose(file);
+    httpd_resp_send_chunk(req, NULL, 0);
     return ESP_OK;
 }
+#endif
+// Control frame payloads are at most 125 bytes
+static esp_err_t ws_control_frame(httpd_req_t *req, int fd, httpd_ws_frame_t* pkt, uint32_t now_ms) {
+    uint8_t payload[125];
+    if (pkt->len > sizeof(payload)) return ESP_FAIL;
+    pkt->payload = payload;
+    if (pkt->len && httpd_ws_recv_frame(req, pkt, sizeof(payload)) != ESP_OK) return ESP_FAIL;
+
+    if (pkt->type == HTTPD_WS_TYPE_PING) {
+        pkt->type = HTTPD_WS_TYPE_PONG;
+        pkt->final = true;
+        return httpd_ws_send_frame(req, pkt);
+    }
+    Session* session = session_get(fd);
+    if (session) session_pong(session, payload, pkt->len, now_ms);
+    return ESP_OK;
+}
+
+// One data or control frame after the handshake
+static esp_err_t ws_frame(httpd_req_t *req, int fd) {
+    int64_t rx_time = esp_timer_get_time();
+
+    httpd_ws_frame_t ws_pkt;
+    memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
+
+    // Read the frame header first so binary control frames can be received
+    // straight onto the stack
+    if (httpd_ws_recv_frame(req, &ws_pkt, 0) != ESP_OK) {
+        ESP_LOGE(TAG, "WS: recv_frame header failed");
+        return ESP_FAIL;
+    }
+
+    // Control frames come here too (handle_ws_control_frames), httpd has
+    // already answered a CLOSE
+    if (ws_pkt.type == HTTPD_WS_TYPE_PING || ws_pkt.type == HTTPD_WS_TYPE_PONG) {
+        return ws_control_frame(req, fd, &ws_pkt, (uint32_t)(rx_time / 1000));
+    }
+    if (ws_pkt.type == HTTPD_WS_TYPE_CLOSE) return ESP_OK;
+
+    ControlCommand cmd;
+    if (ws_pkt.type == HTTPD_WS_TYPE_BINARY) {
+        uint8_t frame[CONTROL_FRAME_SIZE];
+        if (ws_pkt.len != CONTROL_FRAME_SIZE && ws_pkt.len != CONTROL_FRAME_V1_SIZE) {
+            metrics_count(METRIC_PARSE_ERRORS);
+            ESP_LOGE(TAG, "WS: bad binary frame length %d", (int)ws_pkt.len);
+            return ESP_FAIL;
+        }
+        ws_pkt.payload = frame;
+        if (httpd_ws_recv_frame(req, &ws_pkt, sizeof(frame)) != ESP_OK) {
+            ESP_LOGE(TAG, "WS: recv_frame failed");
+            return ESP_FAIL;
+        }
+        if (!command_decode_binary(frame, ws_pkt.len, &cmd)) {
+            metrics_count(METRIC_PARSE_ERRORS);
+            ESP_LOGE(TAG, "WS: bad binary frame version %d", frame[0]);
+            return ESP_FAIL;
+        }
+        event_log(EVT_WS_BINARY, cmd.seq, cmd.throttle, cmd.steering);
+    } else {
+        if (ws_pkt.len >= WS_MAX_SIZE) {
+            metrics_count(METRIC_PARSE_ERRORS);
+            ESP_LOGE(TAG, "WS: frame too large (%d)", (int)ws_pkt.len);
+            return ESP_FAIL;
+        }
+        ws_pkt.payload = ws_text_buf;
+        if (httpd_ws_recv_frame(req, &ws_pkt, sizeof(ws_text_buf)) != ESP_OK) {
+            ESP_LOGE(TAG, "WS: recv_frame failed");
+            return ESP_FAIL;
+        }
+        if (!command_decode_json((const char *)ws_pkt.payload, ws_pkt.len, &cmd)) {
+            metrics_count(METRIC_PARSE_ERRORS);
+            ESP_LOGE(TAG, "WS: bad JSON command frame");
+            return ESP_FAIL;
+        }
+        event_log(EVT_WS_JSON, cmd.kind, cmd.value);
+    }
+
+    session_submit(fd, cmd, rx_time);
+    // No per-frame reply: acks ride on the periodic telemetry frame
+    return ESP_OK;
+}
+
+static bool query_value(httpd_req_t *req, const char* key, char* val, size_t val_size) {
+    char query[32];
+    return httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+           httpd_query_key_value(query, key, val, val_size) == ESP_OK;
+}
+
 static esp_err_t ws_handler(httpd_req_t *req) {
+    int fd = httpd_req_to_sockfd(req);
     if (req->method == HTTP_GET) {
         // Client is connecting
         ESP_LOGI(TAG, "WebSocket client connected");
+        Session* session = session_get(fd);
+        if (session) {
+            // /ws?role=spectator: telemetry only, never drives
+            char role[16];
+            bool spectator = query_value(req, "role", role, sizeof(role)) && strcmp(role, "spectator") == 0;
+            session_upgrade(session, spectator);
+        }
+        // Telemetry and link probes are sent from this task: a client with a
+        // full TCP window may hold it for WS_SEND_TIMEOUT_MS, not the
+        // config's send_wait_timeout of seconds
+        timeval timeout = {};
+        timeout.tv_usec = WS_SEND_TIMEOUT_MS * 1000;
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
         return ESP_OK;
     }
 
-    client_session_id = httpd_req_to_sockfd(req);
+    // Nothing on the frame path may touch the heap once running
+    uint32_t allocs = task_alloc_count();
+    esp_err_t err = ws_frame(req, fd);
+    task_alloc_check(allocs);
+    return err;
+}
 
-    httpd_ws_frame_t ws_pkt;
-    memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
-    
-    ws_pkt.type = HTTPD_WS_TYPE_TEXT;
-    ws_pkt.payload = (uint8_t*)malloc(WS_MAX_SIZE);
-    if (!ws_pkt.payload) {
-        ESP_LOGE(TAG, "WS: malloc failed");
-        return ESP_ERR_NO_MEM;
-    }
-    if (httpd_ws_recv_frame(req, &ws_pkt, WS_MAX_SIZE) != ESP_OK) {
-        ESP_LOGE(TAG, "WS: recv_frame failed");
-        free(ws_pkt.payload);
-        return ESP_FAIL;
+static esp_err_t control_post(httpd_req_t *req) {
+    int64_t rx_time = esp_timer_get_time();
+
+    char body[CONTROL_BODY_MAX];
+    if (req->content_len == 0 || req->content_len > sizeof(body)) {
+        metrics_count(METRIC_PARSE_ERRORS);
+        httpd_resp_set_status(req, req->content_len ? "413 Payload Too Large" : "400 Bad Request");
+        return httpd_resp_send(req, NULL, 0);
+    }
+    size_t got = 0;
+    while (got < req->content_len) {
+        int n = httpd_req_recv(req, body + got, req->content_len - got);
+        if (n == HTTPD_SOCK_ERR_TIMEOUT) continue;
+        if (n <= 0) return ESP_FAIL;   // httpd closes the connection
+        got += n;
     }
 
-    cJSON *payload = cJSON_ParseWithLength((char *)ws_pkt.payload, ws_pkt.len);
-    if (!payload) {
-        ESP_LOGE(TAG, "WS: cJSON_ParseWithLength failed");
-        free(ws_pkt.payload);
-        return ESP_FAIL;
+    ControlCommand cmd;
+    if (!command_decode_setpoint(body, got, &cmd)) {
+        metrics_count(METRIC_PARSE_ERRORS);
+        httpd_resp_set_status(req, "400 Bad Request");
+        return httpd_resp_send(req, NULL, 0);
     }
-    cJSON *typeItem = cJSON_GetObjectItem(payload, "type");
-    cJSON *commandItem = cJSON_GetObjectItem(payload, "command");
-    cJSON *valueItem = cJSON_GetObjectItem(payload, "value");
+    int fd = httpd_req_to_sockfd(req);
+    event_log(EVT_HTTP_CONTROL, fd, cmd.throttle, cmd.steering);
 
-    if (!typeItem || !commandItem || !cJSON_IsString(typeItem) || !cJSON_IsString(commandItem)) {
-        ESP_LOGE(TAG, "WS: JSON missing 'type' or 'command' string");
-        cJSON_Delete(payload);
-        free(ws_pkt.payload);
-        return ESP_FAIL;
+    // Stale setpoints are dropped quietly, as on the WebSocket
+    switch (session_submit(fd, cmd, rx_time)) {
+        case SESSION_NOT_DRIVER:   httpd_resp_set_status(req, "409 Conflict"); break;
+        case SESSION_RATE_LIMITED: httpd_resp_set_status(req, "429 Too Many Requests"); break;
+        default:                   httpd_resp_set_status(req, "204 No Content"); break;
     }
-    const char *type = typeItem->valuestring;
-    const char *command = commandItem->valuestring;
-    int value = 200;
-    if (valueItem && cJSON_IsNumber(valueItem)) {
-        value = valueItem->valueint;
+    return httpd_resp_send(req, NULL, 0);
+}
+
+// POST /control with a setpoint object: throttle and steering land in one
+// command, one round trip per setpoint on a keep-alive connection
+static esp_err_t control_post_handler(httpd_req_t *req) {
+    uint32_t allocs = task_alloc_count();
+    esp_err_t err = control_post(req);
+    task_alloc_check(allocs);
+    return err;
+}
+static void metrics_emit(void* ctx, const char* line) {
+    httpd_resp_sendstr_chunk((httpd_req_t*)ctx, line);
+}
+static esp_err_t metrics_handler(httpd_req_t *req) {
+    httpd_resp_set_type(req, "text/plain");
+    metrics_format(metrics_emit, req);
+    link_format(metrics_emit, req);
+    controls_format(metrics_emit, req);
+    battery_format(metrics_emit, req);
+    boot_format(metrics_emit, req);
+    task_format(metrics_emit, req);
+    udp_control_format(metrics_emit, req);
+    recorder_format(metrics_emit, req);
+    scheduler_format(metrics_emit, req);
+    session_format(metrics_emit, req, (uint32_t)(esp_timer_get_time() / 1000));
+    httpd_resp_sendstr_chunk(req, NULL);
+    return ESP_OK;
+}
+// GET /recording, or /recording?source=flash for the flash copy: the blocks
+// oldest first, as one file for the host replay tool. Served by the asset
+// server, a long flash download must not hold up control traffic.
+static uint8_t recording_buf[RECORDING_BLOCK_SIZE];
+static esp_err_t recording_get_handler(httpd_req_t *req) {
+    char source[8] = "";
+    bool flash = query_value(req, "source", source, sizeof(source)) && strcmp(source, "flash") == 0;
+    uint32_t slots = flash ? recorder_stats().flash_blocks : RECORDER_RAM_BLOCKS;
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"recording.bin\"");
+    for (uint32_t i = 0; i < slots; i++) {
+        bool ok = flash ? recorder_flash_read(i, recording_buf) : recorder_ram_read(i, recording_buf);
+        if (ok && httpd_resp_send_chunk(req, (const char*)recording_buf, RECORDING_BLOCK_SIZE) != ESP_OK) {
+            return ESP_FAIL;
+        }
     }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
 
-    ESP_LOGI(TAG, "WS: type: %s, command: %s, value: %d", type, command, value);
+// POST /recording?flash=1 (or 0) turns the flash copy on (or off)
+static esp_err_t recording_post_handler(httpd_req_t *req) {
+    char flash[4];
+    if (!query_value(req, "flash", flash, sizeof(flash))) {
+        httpd_resp_set_status(req, "400 Bad Request");
+    } else if (recorder_flash_enable(strcmp(flash, "1") == 0) != ESP_OK) {
+        httpd_resp_set_status(req, "404 Not Found");
+    } else {
+        httpd_resp_set_status(req, "204 No Content");
+    }
+    return httpd_resp_send(req, NULL, 0);
+}
 
-    // Bind actions to commands with value
-    if (strcmp(command, "fwd") == 0) {
-        forward(value);
-    } else if (strcmp(command, "rev") == 0) {
-        reverse(value);
-    } else if (strcmp(command, "left") == 0) {
-        left();
-    } else if (strcmp(command, "right") == 0) {
-        right();
-    } else if (strcmp(command, "center") == 0) {
-        center();
-    } else if (strcmp(command, "stop") == 0) {
-        stop();
+// POST /replay plays the RAM recording back, POST /replay?stop=1 ends it
+static esp_err_t replay_post_handler(httpd_req_t *req) {
+    char stop[4];
+    if (query_value(req, "stop", stop, sizeof(stop))) {
+        recorder_replay_stop();
+        httpd_resp_set_status(req, "204 No Content");
+        return httpd_resp_send(req, NULL, 0);
+    }
+    switch (recorder_replay_start()) {
+        case ESP_OK:                httpd_resp_set_status(req, "204 No Content"); break;
+        case ESP_ERR_NOT_FOUND:     httpd_resp_set_status(req, "404 Not Found"); break;
+        case ESP_ERR_INVALID_STATE: httpd_resp_set_status(req, "409 Conflict"); break;
+        default:                    httpd_resp_set_status(req, "500 Internal Server Error"); break;
+    }
+    return httpd_resp_send(req, NULL, 0);
+}
+// POST /maneuver with keyframe lines loads a maneuver (?interpolate=1 to
+// blend between keyframes); with ?run=1 or ?stop=1 and no body it starts or
+// aborts the loaded one
+static Keyframe upload_frames[SCHEDULE_MAX_KEYFRAMES];
+static bool keyframe_line(char* line, size_t len, size_t* count) {
+    while (len > 0 && (line[len - 1] == '\r' || line[len - 1] == ' ')) len--;
+    if (len == 0 || line[0] == '#') return true;
+    return *count < SCHEDULE_MAX_KEYFRAMES && schedule_parse_keyframe(line, len, &upload_frames[(*count)++]);
+}
+static esp_err_t maneuver_load(httpd_req_t *req) {
+    char line[SCHEDULE_LINE_MAX];
+    size_t line_len = 0;
+    size_t count = 0;
+    unsigned int line_no = 1;
+    bool ok = true;
+    size_t left = req->content_len;
+    while (left > 0 && ok) {
+        char chunk[64];
+        int n = httpd_req_recv(req, chunk, left < sizeof(chunk) ? left : sizeof(chunk));
+        if (n == HTTPD_SOCK_ERR_TIMEOUT) continue;
+        if (n <= 0) return ESP_FAIL;
+        left -= n;
+        for (int i = 0; i < n && ok; i++) {
+            if (chunk[i] == '\n') {
+                ok = keyframe_line(line, line_len, &count);
+                if (ok) line_no++;
+                line_len = 0;
+            } else if (line_len < sizeof(line)) {
+                line[line_len++] = chunk[i];
+            } else {
+                ok = false;
+            }
+        }
+    }
+    // The last line may end with the body instead of '\n'
+    if (ok) ok = keyframe_line(line, line_len, &count);
+    if (!ok) {
+        // httpd discards whatever of the body is still unread
+        char msg[48];
+        snprintf(msg, sizeof(msg), "Bad keyframe on line %u", line_no);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, msg);
+        return ESP_OK;
     }
 
-    cJSON_Delete(payload);
-    free(ws_pkt.payload);
+    char interp[4];
+    bool interpolate = query_value(req, "interpolate", interp, sizeof(interp)) && strcmp(interp, "1") == 0;
+    switch (scheduler_load(upload_frames, count, interpolate)) {
+        case ESP_OK:                httpd_resp_set_status(req, "204 No Content"); break;
+        case ESP_ERR_INVALID_STATE: httpd_resp_set_status(req, "409 Conflict"); break;
+        default:                    httpd_resp_set_status(req, "400 Bad Request"); break;
+    }
+    return httpd_resp_send(req, NULL, 0);
+}
 
-    const char *responsestr = "OK";
-    httpd_ws_frame_t ws_responce = {
-        .final = true,
-        .fragmented = false,
-        .type = HTTPD_WS_TYPE_TEXT,
-        .payload = (uint8_t*)responsestr,
-        .len = strlen(responsestr)};
-    esp_err_t send_result = httpd_ws_send_frame(req, &ws_responce);
-    if (send_result != ESP_OK) {
-        ESP_LOGE(TAG, "WS: send_frame failed");
+static esp_err_t maneuver_post_handler(httpd_req_t *req) {
+    char value[4];
+    if (query_value(req, "stop", value, sizeof(value))) {
+        scheduler_abort(SCHEDULE_ABORT_STOPPED);
+        httpd_resp_set_status(req, "204 No Content");
+    } else if (query_value(req, "run", value, sizeof(value))) {
+        switch (scheduler_start()) {
+            case ESP_OK:                httpd_resp_set_status(req, "204 No Content"); break;
+            case ESP_ERR_NOT_FOUND:     httpd_resp_set_status(req, "404 Not Found"); break;
+            case ESP_ERR_INVALID_STATE: httpd_resp_set_status(req, "409 Conflict"); break;
+            default:                    httpd_resp_set_status(req, "500 Internal Server Error"); break;
+        }
+    } else {
+        return maneuver_load(req);
     }
+    return httpd_resp_send(req, NULL, 0);
+}
 
-    return send_result;
+// GET /maneuver: state and the drift of every keyframe
+static esp_err_t maneuver_get_handler(httpd_req_t *req) {
+    httpd_resp_set_type(req, "text/plain");
+    scheduler_report(metrics_emit, req);
+    return httpd_resp_sendstr_chunk(req, NULL);
+}
+// Legacy GET endpoints go through the same arbitration, rate limit and
+// dead-man as every other transport
+static esp_err_t submit_command(httpd_req_t *req, ControlCommandKind kind, int value, const char* reply) {
+    int64_t rx_time = esp_timer_get_time();
+    ControlCommand cmd = {};
+    cmd.kind = kind;
+    cmd.value = value;
+    switch (session_submit(httpd_req_to_sockfd(req), cmd, rx_time)) {
+        case SESSION_NOT_DRIVER:
+            httpd_resp_set_status(req, "409 Conflict");
+            return httpd_resp_send(req, NULL, 0);
+        case SESSION_RATE_LIMITED:
+            httpd_resp_set_status(req, "429 Too Many Requests");
+            return httpd_resp_send(req, NULL, 0);
+        default:
+            return httpd_resp_send(req, reply, HTTPD_RESP_USE_STRLEN);
+    }
 }
 static esp_err_t fwd_handler(httpd_req_t *req) {
-    forward(255);
-    httpd_resp_send(req, "Forward", HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    return submit_command(req, CMD_FWD, 255, "Forward");
 }
 static esp_err_t rev_handler(httpd_req_t *req) {
-    reverse(255);
-    httpd_resp_send(req, "Reverse", HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    return submit_command(req, CMD_REV, 255, "Reverse");
 }
 static esp_err_t stop_handler(httpd_req_t *req) {
-    stop();
-    httpd_resp_send(req, "Stop", HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    return submit_command(req, CMD_STOP, 0, "Stop");
 }
 static esp_err_t left_handler(httpd_req_t *req) {
-    left();
-    httpd_resp_send(req, "Left", HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    return submit_command(req, CMD_LEFT, 0, "Left");
 }
 static esp_err_t right_handler(httpd_req_t *req) {
-    right();
-    httpd_resp_send(req, "Right", HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    return submit_command(req, CMD_RIGHT, 0, "Right");
 }
 static esp_err_t center_handler(httpd_req_t *req) {
-    center();
-    httpd_resp_send(req, "Center", HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    return submit_command(req, CMD_CENTER, 0, "Center");
 }
 
-void start_webserver() {
-    if (server) return; // already started
+static bool start_control_server() {
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = CONTROL_HTTP_PORT;
+    config.ctrl_port = 32768 + 1;       // one UDP control port per instance
+    config.task_priority = CONTROL_HTTPD_PRIORITY;
+    config.stack_size = CONTROL_HTTPD_STACK;
+    config.max_open_sockets = CONTROL_HTTPD_SOCKETS;
+    config.max_uri_handlers = 14;
+    // Never purge: the oldest socket here is usually the driver
+    config.lru_purge_enable = false;
+    config.open_fn = ws_open;
+    config.close_fn = ws_close;
+    if (httpd_start(&control_server, &config) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start control server");
+        return false;
+    }
+
+    // API endpoints
+    httpd_uri_t fwd_uri = { "/fwd", HTTP_GET, fwd_handler, nullptr };
+    httpd_uri_t rev_uri = { "/rev", HTTP_GET, rev_handler, nullptr };
+    httpd_uri_t stop_uri = { "/stop", HTTP_GET, stop_handler, nullptr };
+    httpd_uri_t left_uri = { "/left", HTTP_GET, left_handler, nullptr };
+    httpd_uri_t right_uri = { "/right", HTTP_GET, right_handler, nullptr };
+    httpd_uri_t center_uri = { "/center", HTTP_GET, center_handler, nullptr };
+    httpd_register_uri_handler(control_server, &fwd_uri);
+    httpd_register_uri_handler(control_server, &rev_uri);
+    httpd_register_uri_handler(control_server, &stop_uri);
+    httpd_register_uri_handler(control_server, &left_uri);
+    httpd_register_uri_handler(control_server, &right_uri);
+    httpd_register_uri_handler(control_server, &center_uri);
 
+    httpd_uri_t control_uri = { "/control", HTTP_POST, control_post_handler, nullptr };
+    httpd_register_uri_handler(control_server, &control_uri);
+
+    httpd_uri_t metrics_uri = { "/metrics", HTTP_GET, metrics_handler, nullptr };
+    httpd_register_uri_handler(control_server, &metrics_uri);
+
+    httpd_uri_t recording_uri = { "/recording", HTTP_POST, recording_post_handler, nullptr };
+    httpd_uri_t replay_uri = { "/replay", HTTP_POST, replay_post_handler, nullptr };
+    httpd_register_uri_handler(control_server, &recording_uri);
+    httpd_register_uri_handler(control_server, &replay_uri);
+
+    httpd_uri_t maneuver_post_uri = { "/maneuver", HTTP_POST, maneuver_post_handler, nullptr };
+    httpd_uri_t maneuver_get_uri = { "/maneuver", HTTP_GET, maneuver_get_handler, nullptr };
+    httpd_register_uri_handler(control_server, &maneuver_post_uri);
+    httpd_register_uri_handler(control_server, &maneuver_get_uri);
+
+    // WebSocket endpoint
+    httpd_uri_t ws_uri = {
+        .uri = "/ws",
+        .method = HTTP_GET,
+        .handler = ws_handler,
+        .is_websocket = true,
+        .handle_ws_control_frames = true   // pongs feed the link supervisor
+    };
+    httpd_register_uri_handler(control_server, &ws_uri);
+
+    ESP_LOGI(TAG, "Control server started on port %d", CONTROL_HTTP_PORT);
+    boot_mark(BOOT_HTTPD);
+    telemetry_start(control_server);
+    link_start(control_server);
+#ifdef UDP_CONTROL_ENABLED
+    udp_control_start(control_server);
+#endif
+    return true;
+}
+
+static bool start_asset_server() {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.uri_match_fn = httpd_uri_match_wildcard;
-    if (httpd_start(&server, &config) == ESP_OK) {
-        // API endpoints
-        httpd_uri_t fwd_uri = { "/fwd", HTTP_GET, fwd_handler, nullptr };
-        httpd_uri_t rev_uri = { "/rev", HTTP_GET, rev_handler, nullptr };
-        httpd_uri_t stop_uri = { "/stop", HTTP_GET, stop_handler, nullptr };
-        httpd_uri_t left_uri = { "/left", HTTP_GET, left_handler, nullptr };
-        httpd_uri_t right_uri = { "/right", HTTP_GET, right_handler, nullptr };
-        httpd_uri_t center_uri = { "/center", HTTP_GET, center_handler, nullptr };
-        httpd_register_uri_handler(server, &fwd_uri);
-        httpd_register_uri_handler(server, &rev_uri);
-        httpd_register_uri_handler(server, &stop_uri);
-        httpd_register_uri_handler(server, &left_uri);
-        httpd_register_uri_handler(server, &right_uri);
-        httpd_register_uri_handler(server, &center_uri);
-
-        // WebSocket endpoint
-        httpd_uri_t ws_uri = {
-            .uri = "/ws",
-            .method = HTTP_GET,
-            .handler = ws_handler,
-            .is_websocket = true
-        };
-        httpd_register_uri_handler(server, &ws_uri);
-        // Static file handler for all GET requests
-        httpd_uri_t static_uri = {
-            .uri = "/*",
-            .method = HTTP_GET,
-            .handler = static_get_handler,
-            .user_ctx = nullptr
-        };
-        httpd_register_uri_handler(server, &static_uri);
-
-        ESP_LOGI(TAG, "HTTP Server started");
-    } else {
-        ESP_LOGE(TAG, "Failed to start server");
+    config.task_priority = ASSET_HTTPD_PRIORITY;
+    config.max_open_sockets = ASSET_HTTPD_SOCKETS;
+    // Browsers open several parallel connections for the bundle and keep
+    // them alive; recycle the idlest instead of refusing new ones
+    config.lru_purge_enable = true;
+    if (httpd_start(&asset_server, &config) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start asset server");
+        return false;
     }
+
+    // Ahead of the wildcard, handlers match in registration order
+    httpd_uri_t recording_uri = { "/recording", HTTP_GET, recording_get_handler, nullptr };
+    httpd_register_uri_handler(asset_server, &recording_uri);
+
+    // Static file handler for all GET requests
+    httpd_uri_t static_uri = {
+        .uri = "/*",
+        .method = HTTP_GET,
+        .handler = static_get_handler,
+        .user_ctx = nullptr
+    };
+    httpd_register_uri_handler(asset_server, &static_uri);
+#ifdef WEB_ASSETS_EMBEDDED
+    boot_mark(BOOT_ASSETS);
+#else
+    httpd_queue_work(asset_server, mount_assets, nullptr);
+#endif
+
+    ESP_LOGI(TAG, "Asset server started on port %d", config.server_port);
+    return true;
+}
+
+void start_webserver() {
+    if (control_server) return; // already started
+
+    // Control first, so it still comes up if sockets run short
+    if (start_control_server()) start_asset_server();
 }
@@ -0,0 +1,57 @@
+#include "includes/wheel_encoder.hpp"
+#include "driver/pulse_cnt.h"
+#include "esp_log.h"
+
+static const char* TAG = "wheel_encoder";
+
+static pcnt_unit_handle_t unit = nullptr;
+
+esp_err_t wheel_encoder_init(gpio_num_t a_pin, gpio_num_t b_pin) {
+    pcnt_unit_config_t unit_cfg = {};
+    unit_cfg.low_limit = -WHEEL_ENCODER_PCNT_LIMIT;
+    unit_cfg.high_limit = WHEEL_ENCODER_PCNT_LIMIT;
+    unit_cfg.flags.accum_count = 1;
+    esp_err_t err = pcnt_new_unit(&unit_cfg, &unit);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "No PCNT unit (err=%d)", err);
+        return err;
+    }
+
+    pcnt_glitch_filter_config_t filter = {};
+    filter.max_glitch_ns = WHEEL_ENCODER_GLITCH_NS;
+    ESP_ERROR_CHECK(pcnt_unit_set_glitch_filter(unit, &filter));
+
+    // Each channel counts the edges of one phase, the other phase's level
+    // gives the direction
+    pcnt_chan_config_t a_cfg = {};
+    a_cfg.edge_gpio_num = a_pin;
+    a_cfg.level_gpio_num = b_pin;
+    pcnt_channel_handle_t a_chan;
+    ESP_ERROR_CHECK(pcnt_new_channel(unit, &a_cfg, &a_chan));
+    pcnt_chan_config_t b_cfg = {};
+    b_cfg.edge_gpio_num = b_pin;
+    b_cfg.level_gpio_num = a_pin;
+    pcnt_channel_handle_t b_chan;
+    ESP_ERROR_CHECK(pcnt_new_channel(unit, &b_cfg, &b_chan));
+
+    ESP_ERROR_CHECK(pcnt_channel_set_edge_action(a_chan, PCNT_CHANNEL_EDGE_ACTION_DECREASE, PCNT_CHANNEL_EDGE_ACTION_INCREASE));
+    ESP_ERROR_CHECK(pcnt_channel_set_level_action(a_chan, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE));
+    ESP_ERROR_CHECK(pcnt_channel_set_edge_action(b_chan, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_DECREASE));
+    ESP_ERROR_CHECK(pcnt_channel_set_level_action(b_chan, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE));
+
+    // accum_count needs watch points on the limits to catch the wraps
+    ESP_ERROR_CHECK(pcnt_unit_add_watch_point(unit, WHEEL_ENCODER_PCNT_LIMIT));
+    ESP_ERROR_CHECK(pcnt_unit_add_watch_point(unit, -WHEEL_ENCODER_PCNT_LIMIT));
+
+    ESP_ERROR_CHECK(pcnt_unit_enable(unit));
+    ESP_ERROR_CHECK(pcnt_unit_clear_count(unit));
+    ESP_ERROR_CHECK(pcnt_unit_start(unit));
+    ESP_LOGI(TAG, "Encoder on GPIO %d/%d", a_pin, b_pin);
+    return ESP_OK;
+}
+
+int32_t wheel_encoder_count() {
+    int count = 0;
+    pcnt_unit_get_count(unit, &count);
+    return count;
+}
@@ -1,5 +1,7 @@
 #include "includes/wifi.hpp"
+#include "includes/boot_report.hpp"
 #include "includes/led_status.hpp"
+#include "includes/tasks.hpp"
 #include "nvs_flash.h"
 #include "esp_netif.h"
 #include "esp_event.h"
@@ -12,7 +14,10 @@ static const char* TAG = "WiFi";
 
 static void wifi_event_handler(void* arg, esp_event_base_t event_base,
                                int32_t event_id, void* event_data) {
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STACONNECTED) {
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_START) {
+        boot_mark(BOOT_AP_STARTED);
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STACONNECTED) {
+        boot_mark(BOOT_FIRST_CLIENT);
         wifi_event_ap_staconnected_t* event = (wifi_event_ap_staconnected_t*) event_data;
         ESP_LOGI(TAG, "Client " MACSTR " joined, AID=%d", MAC2STR(event->mac), event->aid);
         led_status_set(0, 255, 0);
@@ -23,13 +28,23 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
     }
 }
 
-void wifi_init_softap(const char* ssid, const char* pass) {
+struct WifiStartArgs {
+    const char* ssid;
+    const char* pass;
+    TaskHandle_t ready;
+};
+
+static WifiStartArgs start_args;
+
+// NVS, lwIP and the default event loop: everything a server needs to bind
+static void wifi_init_stack() {
     // Initialize NVS (needed by Wi-Fi)
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
         ESP_ERROR_CHECK(nvs_flash_erase());
         ESP_ERROR_CHECK(nvs_flash_init());
     }
+    boot_mark(BOOT_NVS);
 
     // Initialize network stack
     ESP_ERROR_CHECK(esp_netif_init());
@@ -39,7 +54,10 @@ void wifi_init_softap(const char* ssid, const char* pass) {
     if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
         ESP_ERROR_CHECK(ret);
     }
+    boot_mark(BOOT_NETIF);
+}
 
+static void wifi_start_ap(const char* ssid, const char* pass) {
     // Create default AP interface
     esp_netif_create_default_wifi_ap();
 
@@ -79,3 +97,16 @@ void wifi_init_softap(const char* ssid, const char* pass) {
     ESP_LOGI(TAG, "Password: %s", pass);
     led_status_set(0, 255, 0);
 }
+
+static void wifi_start_task(void* param) {
+    wifi_init_stack();
+    xTaskNotifyGive(start_args.ready);
+    wifi_start_ap(start_args.ssid, start_args.pass);
+    task_exit();
+}
+
+void wifi_start_softap(const char* ssid, const char* pass, TaskHandle_t ready) {
+    start_args = { ssid, pass, ready };
+    static TaskStorage<4096> storage;
+    task_spawn(wifi_start_task, "wifi_start", NULL, 5, storage);
+}
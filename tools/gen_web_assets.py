@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""Compile app/dist into a C++ source with a path-sorted WebAsset table.
+
+    gen_web_assets.py <dist dir> <output .cpp>
+
+Where build_frontend wrote a .gz copy, only the compressed bytes are
+embedded and the entry is flagged gzip. The output is only rewritten when
+its contents change so unchanged bundles don't trigger a relink.
+"""
+import os
+import sys
+
+MIME_TYPES = {
+    ".html": "text/html",
+    ".js": "text/javascript",
+    ".css": "text/css",
+    ".json": "application/json",
+    ".webmanifest": "application/manifest+json",
+    ".png": "image/png",
+    ".svg": "image/svg+xml",
+    ".ico": "image/x-icon",
+    ".woff2": "font/woff2",
+    ".txt": "text/plain",
+}
+
+
+def fnv1a(data):
+    h = 2166136261
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def collect(dist):
+    assets = {}
+    for root, _, files in os.walk(dist):
+        for name in files:
+            if name.endswith(".gz"):
+                continue
+            full = os.path.join(root, name)
+            path = "/" + os.path.relpath(full, dist).replace(os.sep, "/")
+            gzip = os.path.exists(full + ".gz")
+            with open(full + ".gz" if gzip else full, "rb") as f:
+                data = f.read()
+            mime = MIME_TYPES.get(os.path.splitext(name)[1], "application/octet-stream")
+            assets[path] = (data, mime, gzip)
+    return assets
+
+
+def render(assets):
+    out = ["// Generated by tools/gen_web_assets.py from app/dist, do not edit",
+           '#include "includes/web_assets.hpp"', ""]
+    for i, (path, (data, _, _)) in enumerate(sorted(assets.items())):
+        out.append("// %s" % path)
+        out.append("static const uint8_t asset_%d[] = {" % i)
+        for off in range(0, len(data), 16):
+            out.append("    " + ", ".join("0x%02x" % b for b in data[off:off + 16]) + ",")
+        out.append("};")
+    out.append("")
+    out.append("const WebAsset WEB_ASSETS[] = {")
+    for i, (path, (data, mime, gzip)) in enumerate(sorted(assets.items())):
+        etag = '\\"%08x-%x\\"' % (fnv1a(data), len(data))
+        out.append('    { "%s", asset_%d, %d, "%s", %s, "%s" },'
+                   % (path, i, len(data), mime, "true" if gzip else "false", etag))
+    out.append("};")
+    out.append("const size_t WEB_ASSETS_COUNT = sizeof(WEB_ASSETS) / sizeof(WEB_ASSETS[0]);")
+    return "\n".join(out) + "\n"
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    dist, output = sys.argv[1], sys.argv[2]
+    assets = collect(dist)
+    if not assets:
+        sys.exit("%s is empty, run the frontend build first" % dist)
+    text = render(assets)
+    if os.path.exists(output):
+        with open(output) as f:
+            if f.read() == text:
+                return
+    with open(output, "w") as f:
+        f.write(text)
+
+
+if __name__ == "__main__":
+    main()